@@ -0,0 +1,247 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <AllocSpec.hpp>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+#define DEBUG_TYPE "mvxaa"
+
+using namespace llvm;
+
+// Externals SVF already models as allocating a new object per call site,
+// wrapper calls are pointed at these while solving
+static const char *const RETURN_STUB = "malloc";
+static const char *const ARG0_STUB = "posix_memalign";
+
+/**
+ * @brief Starts out with the allocators of libc and of the test corpora
+ */
+AllocSpec::AllocSpec() {
+    add("malloc", RETURN_VALUE, 0);
+    add("calloc", RETURN_VALUE, UNKNOWN_SIZE);
+    add("realloc", RETURN_VALUE, 1);
+    add("strdup", RETURN_VALUE, UNKNOWN_SIZE);
+    add("strndup", RETURN_VALUE, UNKNOWN_SIZE);
+    add("ngx_alloc", RETURN_VALUE, 0);
+    add("ngx_calloc", RETURN_VALUE, 0);
+    add("ngx_palloc", RETURN_VALUE, 1);
+    add("ngx_pnalloc", RETURN_VALUE, 1);
+    add("ngx_pcalloc", RETURN_VALUE, 1);
+    add("ngx_pmemalign", RETURN_VALUE, 1);
+    add("xmalloc", RETURN_VALUE, 0);
+    add("xcalloc", RETURN_VALUE, UNKNOWN_SIZE);
+    add("xreallocarray", RETURN_VALUE, UNKNOWN_SIZE);
+    add("xstrdup", RETURN_VALUE, UNKNOWN_SIZE);
+    add("buffer_init", RETURN_VALUE, UNKNOWN_SIZE);
+}
+
+void AllocSpec::add(StringRef name, int allocArg, int sizeArg,
+                    bool initializes) {
+    Entry E = {allocArg, sizeArg, initializes};
+    m_entries[name] = E;
+}
+
+const AllocSpec::Entry *AllocSpec::lookup(StringRef name) const {
+    auto it = m_entries.find(name);
+    return it == m_entries.end() ? nullptr : &it->second;
+}
+
+/**
+ * @brief Add the allocators of a spec file, see the class comment for the
+ * format
+ *
+ * @param path
+ * @param error Set on failure
+ *
+ * @return false if the file can't be read or is malformed
+ */
+bool AllocSpec::loadFile(StringRef path, std::string &error) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> buf = MemoryBuffer::getFile(path);
+    if (!buf) {
+        error = "can't read " + path.str() + ": " + buf.getError().message();
+        return false;
+    }
+    SmallVector<StringRef, 0> lines;
+    (*buf)->getBuffer().split(lines, '\n', -1, false);
+    for (unsigned i = 0; i < lines.size(); ++i) {
+        StringRef line = lines[i].split('#').first.trim();
+        if (line.empty()) {
+            continue;
+        }
+        SmallVector<StringRef, 4> fields;
+        line.split(fields, ' ', -1, false);
+        int allocArg = RETURN_VALUE;
+        int sizeArg = UNKNOWN_SIZE;
+        bool ok = fields.size() == 3 ||
+                  (fields.size() == 4 && fields[3] == "init");
+        if (ok && fields[1] != "ret") {
+            ok = fields[1].consume_front("arg") &&
+                 !fields[1].getAsInteger(10, allocArg) && allocArg >= 0;
+        }
+        if (ok && fields[2] != "-") {
+            ok = !fields[2].getAsInteger(10, sizeArg) && sizeArg >= 0;
+        }
+        if (!ok) {
+            error = path.str() + ":" + std::to_string(i + 1) +
+                    ": expected '<function> <ret|argN> <size arg|-> [init]'";
+            return false;
+        }
+        add(fields[0], allocArg, sizeArg, fields.size() == 4);
+        m_specified.push_back(fields[0].str());
+    }
+    return true;
+}
+
+/**
+ * @brief SVF only treats calls to known external allocators as creating new
+ * heap objects. A wrapper defined in the module is analyzed like any other
+ * function, so the objects of all its callers merge into one. For the solve,
+ * calls of the specified wrappers are split per call site; restoreAfterSolve
+ * undoes this.
+ *
+ * Initializing wrappers are cloned first, so the allocations inside the
+ * clones get split too. Pure allocators are then pointed at an external SVF
+ * already models as allocating, only returned objects and objects stored
+ * through the first argument have one.
+ *
+ * @param M
+ */
+void AllocSpec::redirectForSolve(Module &M) {
+    for (const std::string &name : m_specified) {
+        Function *wrapper = M.getFunction(name);
+        if (wrapper && !wrapper->isDeclaration() &&
+            m_entries[name].initializes) {
+            cloneForSolve(wrapper);
+        }
+    }
+    for (const std::string &name : m_specified) {
+        Function *wrapper = M.getFunction(name);
+        if (wrapper && !wrapper->isDeclaration() &&
+            !m_entries[name].initializes) {
+            redirectToStub(wrapper, m_entries[name]);
+        }
+    }
+}
+
+/**
+ * @brief Point every call of an initializing wrapper at a copy of its own.
+ * Each copy allocates and fills its caller's object, so callers don't share
+ * one. Each copy also calls the wrapper itself, which keeps the wrapper's
+ * body solved for the arguments of all its callers, for when the walk visits
+ * it.
+ *
+ * @param wrapper
+ */
+void AllocSpec::cloneForSolve(Function *wrapper) {
+    if (wrapper->isVarArg()) {
+        errs() << "MVXAA: can't clone " << wrapper->getName()
+               << " per call site, it is variadic\n";
+        return;
+    }
+    SmallVector<CallBase *, 16> calls;
+    for (User *U : wrapper->users()) {
+        CallBase *CB = dyn_cast<CallBase>(U);
+        if (CB && CB->getCalledOperand() == wrapper) {
+            calls.push_back(CB);
+        }
+    }
+    for (CallBase *CB : calls) {
+        ValueToValueMapTy VMap;
+        Function *clone = CloneFunction(wrapper, VMap);
+        clone->setName("__mvx_clone_" + wrapper->getName());
+        clone->setLinkage(GlobalValue::InternalLinkage);
+        m_clones.insert(clone);
+
+        SmallVector<Value *, 8> args;
+        for (Argument &arg : clone->args()) {
+            args.push_back(&arg);
+        }
+        IRBuilder<> builder(&*clone->getEntryBlock().getFirstInsertionPt());
+        builder.CreateCall(wrapper, args);
+
+        m_redirected.insert(std::make_pair(CB, wrapper));
+        CB->setCalledOperand(clone);
+    }
+}
+
+/**
+ * @brief Point every call of a pure allocator at the external SVF models the
+ * same way
+ *
+ * @param wrapper
+ * @param E
+ */
+void AllocSpec::redirectToStub(Function *wrapper, const Entry &E) {
+    Module &M = *wrapper->getParent();
+    if (E.allocArg != RETURN_VALUE && E.allocArg != 0) {
+        errs() << "MVXAA: can't model " << wrapper->getName()
+               << " as an allocator, only 'ret' and 'arg0' are supported\n";
+        return;
+    }
+
+    Type *i8Ptr = Type::getInt8PtrTy(M.getContext());
+    Type *sizeTy = M.getDataLayout().getIntPtrType(M.getContext());
+    StringRef stubName = E.allocArg == RETURN_VALUE ? RETURN_STUB
+                                                    : ARG0_STUB;
+    FunctionType *stubTy =
+        E.allocArg == RETURN_VALUE
+            ? FunctionType::get(i8Ptr, {sizeTy}, false)
+            : FunctionType::get(Type::getInt32Ty(M.getContext()),
+                                {i8Ptr->getPointerTo(), sizeTy, sizeTy},
+                                false);
+    if (!M.getFunction(stubName)) {
+        m_createdStubs.push_back(Function::Create(
+            stubTy, GlobalValue::ExternalLinkage, stubName, M));
+    }
+    Constant *stub = M.getFunction(stubName);
+
+    // Collect first, redirecting removes the calls from the use list
+    SmallVector<CallBase *, 16> calls;
+    for (User *U : wrapper->users()) {
+        CallBase *CB = dyn_cast<CallBase>(U);
+        if (CB && CB->getCalledOperand() == wrapper) {
+            calls.push_back(CB);
+        }
+    }
+    for (CallBase *CB : calls) {
+        m_redirected.insert(std::make_pair(CB, wrapper));
+        CB->setCalledOperand(
+            ConstantExpr::getBitCast(stub, wrapper->getType()));
+    }
+}
+
+/**
+ * @brief Point redirected calls back at their wrappers and drop any stub
+ * declarations redirectForSolve had to add
+ */
+void AllocSpec::restoreAfterSolve() {
+    for (auto &redirect : m_redirected) {
+        Constant *stubCast = cast<Constant>(redirect.first->getCalledOperand());
+        redirect.first->setCalledOperand(redirect.second);
+        // Clones are called directly, and stay until release
+        if (stubCast->use_empty() && isa<ConstantExpr>(stubCast)) {
+            stubCast->destroyConstant();
+        }
+    }
+    m_redirected.clear();
+    for (Function *stub : m_createdStubs) {
+        if (stub->use_empty()) {
+            stub->eraseFromParent();
+        }
+    }
+    m_createdStubs.clear();
+}
+
+/**
+ * @brief Erase the clones. Only once the SVF state is gone, as it refers to
+ * their instructions.
+ */
+void AllocSpec::release() {
+    for (Function *clone : m_clones) {
+        clone->eraseFromParent();
+    }
+    m_clones.clear();
+}
@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <CSRWriter.hpp>
+#include <llvm/Support/EndianStream.h>
+
+#include <cassert>
+
+using namespace llvm;
+
+/**
+ * @brief Write the 8 byte magic identifying the table, must come first
+ *
+ * @param magic Up to 8 characters, NUL padded
+ */
+void CSRWriter::writeMagic(StringRef magic) {
+    assert(m_written == 0 && magic.size() <= 8 && "Bad table magic!");
+    m_OS << magic;
+    m_OS.write_zeros(8 - magic.size());
+    m_written += 8;
+}
+
+void CSRWriter::writeArray(ArrayRef<uint64_t> values) {
+    support::endian::Writer writer(m_OS, support::little);
+    for (uint64_t value : values) {
+        writer.write(value);
+    }
+    m_written += values.size() * sizeof(uint64_t);
+}
+
+void CSRWriter::writeArray(ArrayRef<uint32_t> values) {
+    support::endian::Writer writer(m_OS, support::little);
+    for (uint32_t value : values) {
+        writer.write(value);
+    }
+    m_written += values.size() * sizeof(uint32_t);
+    pad();
+}
+
+/**
+ * @brief Concatenate NUL-terminated strings, recording where each starts.
+ * starts gets strings.size() + 1 entries, the last is the blob's size.
+ *
+ * @param strings
+ * @param starts
+ * @param blob
+ */
+void CSRWriter::appendStrings(ArrayRef<std::string> strings,
+                              std::vector<uint64_t> &starts,
+                              std::string &blob) {
+    for (const std::string &S : strings) {
+        starts.push_back(blob.size());
+        blob += S;
+        blob += '\0';
+    }
+    starts.push_back(blob.size());
+}
+
+/**
+ * @brief Write raw bytes, like a string blob from appendStrings
+ *
+ * @param blob
+ */
+void CSRWriter::writeBlob(StringRef blob) {
+    m_OS << blob;
+    m_written += blob.size();
+    pad();
+}
+
+void CSRWriter::pad() {
+    unsigned padding = (8 - m_written % 8) % 8;
+    m_OS.write_zeros(padding);
+    m_written += padding;
+}
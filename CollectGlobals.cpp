@@ -20,7 +20,7 @@ bool CollectGlobals::runOnModule(Module &M) {
 
 bool CollectGlobals::doInitialization(Module &M) { return false; }
 
-std::unique_ptr<DenseSet<Value *>> CollectGlobals::getResult() {
+std::unique_ptr<SetVector<Value *>> CollectGlobals::getResult() {
     return std::move(m_globals);
 }
 
@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <ConservativeGlobals.hpp>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+
+using namespace llvm;
+
+namespace conservative {
+
+static bool isRelocatable(const Value *V, const SetVector<Value *> &globals) {
+    return globals.count(const_cast<Value *>(V)) &&
+           !cast<GlobalVariable>(V)->isConstant();
+}
+
+/**
+ * @brief Is the address of V (or of a constant GEP/cast of it) used as a
+ * value, rather than only as the pointer operand of loads and stores?
+ *
+ * @param V
+ *
+ * @return
+ */
+bool isAddressTaken(const Value *V) {
+    for (const Use &U : V->uses()) {
+        const User *user = U.getUser();
+        if (isa<LoadInst>(user)) {
+            continue;
+        }
+        if (const StoreInst *SI = dyn_cast<StoreInst>(user)) {
+            if (SI->getPointerOperand() == V) {
+                continue;
+            }
+            return true;
+        }
+        if (isa<ConstantExpr>(user)) {
+            if (isAddressTaken(user)) {
+                return true;
+            }
+            continue;
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Non-constant globals whose address escapes anywhere in the module,
+ * any pointer in the guarded region may point into these
+ *
+ * @param M
+ * @param globals Globals collected by CollectGlobals
+ * @param result
+ */
+void collectAddressTakenGlobals(Module &M, const SetVector<Value *> &globals,
+                                SetVector<Value *> &result) {
+    for (GlobalVariable &G : M.globals()) {
+        if (isRelocatable(&G, globals) && isAddressTaken(&G)) {
+            result.insert(&G);
+        }
+    }
+}
+
+/**
+ * @brief Non-constant globals named by F's instructions, including through
+ * constant expressions
+ *
+ * @param F
+ * @param globals Globals collected by CollectGlobals
+ * @param result
+ */
+void collectReferencedGlobals(Function &F, const SetVector<Value *> &globals,
+                              SetVector<Value *> &result) {
+    SmallVector<const Value *, 16> worklist;
+    SmallPtrSet<const Value *, 16> seen;
+    for (Instruction &I : instructions(F)) {
+        for (const Value *op : I.operands()) {
+            worklist.push_back(op);
+        }
+    }
+    while (!worklist.empty()) {
+        const Value *V = worklist.pop_back_val();
+        if (!seen.insert(V).second) {
+            continue;
+        }
+        if (isa<GlobalVariable>(V)) {
+            if (isRelocatable(V, globals)) {
+                result.insert(const_cast<Value *>(V));
+            }
+        } else if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
+            for (const Value *op : CE->operands()) {
+                worklist.push_back(op);
+            }
+        }
+    }
+}
+
+} // namespace conservative
@@ -0,0 +1,385 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <ConservativeGlobals.hpp>
+#include <DispatchTables.hpp>
+#include <LibcSummaries.hpp>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Operator.h>
+
+#define DEBUG_TYPE "mvxaa"
+
+using namespace llvm;
+
+// Bounds the fan-out of resolving through tables of tables
+#define MAX_POINTEES (256)
+#define MAX_DEPTH (8)
+
+// Written size used when it isn't known
+#define UNKNOWN_SIZE (~0ULL)
+
+DispatchTables::DispatchTables(Module &M, AliasFn_t mayAlias)
+    : m_DL(M.getDataLayout()) {
+    findTables(M);
+    findWrites(M, mayAlias);
+    m_pointedTables.clear();
+}
+
+/**
+ * @brief Does C hold the address of a function, or of (a part of) a table?
+ */
+bool DispatchTables::holdsTargets(const Constant *C) const {
+    const Value *V = C->stripPointerCasts();
+    if (const GEPOperator *GEP = dyn_cast<GEPOperator>(V)) {
+        V = GEP->getPointerOperand()->stripPointerCasts();
+    }
+    if (isa<Function>(V)) {
+        return true;
+    }
+    if (const GlobalVariable *G = dyn_cast<GlobalVariable>(V)) {
+        return isTable(G);
+    }
+    if (isa<ConstantAggregate>(C)) {
+        for (const Use &op : C->operands()) {
+            if (holdsTargets(cast<Constant>(op))) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Tables are globals holding function addresses, or addresses of
+ * other tables, like ngx_modules[] holding &ngx_core_module. Globals holding
+ * only data addresses never resolve a call.
+ *
+ * @param M
+ */
+void DispatchTables::findTables(Module &M) {
+    SmallVector<GlobalVariable *, 32> candidates;
+    for (GlobalVariable &G : M.globals()) {
+        if (!G.isConstant() && G.hasDefinitiveInitializer()) {
+            candidates.push_back(&G);
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (GlobalVariable *G : candidates) {
+            if (!isTable(G) && holdsTargets(G->getInitializer())) {
+                m_tables.insert(G);
+                changed = true;
+            }
+        }
+    }
+    for (const GlobalVariable *G : m_tables) {
+        if (conservative::isAddressTaken(G)) {
+            m_escapedTables.push_back(G);
+        }
+    }
+}
+
+/**
+ * @brief Record every store-like write into memory that may be a table
+ *
+ * @param M
+ * @param mayAlias
+ */
+void DispatchTables::findWrites(Module &M, AliasFn_t &mayAlias) {
+    for (Function &F : M) {
+        for (Instruction &I : instructions(F)) {
+            if (StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+                addWrite(SI->getPointerOperand(),
+                         m_DL.getTypeStoreSize(
+                             SI->getValueOperand()->getType()),
+                         mayAlias);
+            } else if (AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(&I)) {
+                addWrite(RMW->getPointerOperand(), UNKNOWN_SIZE, mayAlias);
+            } else if (AtomicCmpXchgInst *CX =
+                           dyn_cast<AtomicCmpXchgInst>(&I)) {
+                addWrite(CX->getPointerOperand(), UNKNOWN_SIZE, mayAlias);
+            } else if (CallBase *CB = dyn_cast<CallBase>(&I)) {
+                Function *callee = CB->getCalledFunction();
+                if (!callee || !callee->isDeclaration()) {
+                    // Defined callees are covered by their own stores
+                    continue;
+                }
+                const LibcSummary *S = lookupLibcSummary(callee->getName());
+                if (S) {
+                    if (S->writeArg >= 0 &&
+                        (unsigned)S->writeArg < CB->arg_size()) {
+                        addWrite(CB->getArgOperand(S->writeArg), UNKNOWN_SIZE,
+                                 mayAlias);
+                    }
+                    continue;
+                }
+                if (callee->isIntrinsic() || callee->onlyReadsMemory()) {
+                    continue;
+                }
+                // Unknown external, assume it writes through every pointer
+                for (Value *arg : CB->args()) {
+                    if (arg->getType()->isPointerTy()) {
+                        addWrite(arg, UNKNOWN_SIZE, mayAlias);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Record a write of size bytes at ptr. The offset into the table is
+ * known when ptr is a constant GEP from the table itself, or from a pointer
+ * to an object of the table's type.
+ *
+ * @param ptr
+ * @param size
+ * @param mayAlias
+ */
+void DispatchTables::addWrite(Value *ptr, uint64_t size, AliasFn_t &mayAlias) {
+    APInt offset(m_DL.getIndexTypeSizeInBits(ptr->getType()), 0);
+    bool offsetKnown = size != UNKNOWN_SIZE;
+    Type *objectTy = nullptr;
+    Value *base = ptr->stripPointerCasts();
+    while (GEPOperator *GEP = dyn_cast<GEPOperator>(base)) {
+        if (!GEP->accumulateConstantOffset(m_DL, offset)) {
+            offsetKnown = false;
+        }
+        objectTy = GEP->getSourceElementType();
+        base = GEP->getPointerOperand()->stripPointerCasts();
+    }
+    if (isa<AllocaInst>(base) || isa<Function>(base)) {
+        return;
+    }
+
+    if (GlobalVariable *baseGlobal = dyn_cast<GlobalVariable>(base)) {
+        if (!isTable(baseGlobal)) {
+            return;
+        }
+        if (offsetKnown) {
+            m_written[baseGlobal].push_back(
+                std::make_pair(offset.getZExtValue(), size));
+        } else {
+            m_wholeWritten.insert(baseGlobal);
+        }
+        return;
+    }
+    for (const GlobalVariable *G : pointedTables(base, mayAlias)) {
+        if (offsetKnown && objectTy == G->getValueType()) {
+            m_written[G].push_back(
+                std::make_pair(offset.getZExtValue(), size));
+        } else {
+            m_wholeWritten.insert(G);
+        }
+    }
+}
+
+/**
+ * @brief The tables base may point to, asked of the solve once per base
+ * pointer however many stores go through it. Only tables whose address
+ * escapes can be reached through a pointer at all.
+ *
+ * @param base
+ * @param mayAlias
+ */
+const DispatchTables::Tables_t &
+DispatchTables::pointedTables(Value *base, AliasFn_t &mayAlias) {
+    auto inserted = m_pointedTables.try_emplace(base);
+    Tables_t &tables = inserted.first->second;
+    if (!inserted.second) {
+        return tables;
+    }
+    for (const GlobalVariable *G : m_escapedTables) {
+        if (mayAlias(base, const_cast<GlobalVariable *>(G))) {
+            tables.push_back(G);
+        }
+    }
+    return tables;
+}
+
+/**
+ * @brief Is nothing of G ever written?
+ *
+ * @param G
+ *
+ * @return false for globals that aren't tables
+ */
+bool DispatchTables::isReadOnly(const GlobalVariable *G) const {
+    return isTable(G) && !m_wholeWritten.count(G) && !m_written.count(G);
+}
+
+/**
+ * @brief Is no byte of [offset, offset + size) of G ever written?
+ *
+ * @param G
+ * @param offset
+ * @param size
+ *
+ * @return false for globals that aren't tables
+ */
+bool DispatchTables::isReadOnly(const GlobalVariable *G, uint64_t offset,
+                                uint64_t size) const {
+    if (!isTable(G) || m_wholeWritten.count(G)) {
+        return false;
+    }
+    auto it = m_written.find(G);
+    if (it == m_written.end()) {
+        return true;
+    }
+    for (const std::pair<uint64_t, uint64_t> &range : it->second) {
+        if (range.first < offset + size &&
+            offset < range.first + range.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Apply GEP indices from idx on to a constant, fanning out over every
+ * element for non-constant array indices
+ *
+ * @return false if an index can't be followed
+ */
+bool DispatchTables::descend(const Pointee &base, GEPOperator *GEP,
+                             unsigned idx, SmallVectorImpl<Pointee> &out) {
+    if (idx == GEP->getNumOperands()) {
+        out.push_back(base);
+        return out.size() <= MAX_POINTEES;
+    }
+    Type *T = base.C->getType();
+    ConstantInt *CI = dyn_cast<ConstantInt>(GEP->getOperand(idx));
+    if (StructType *ST = dyn_cast<StructType>(T)) {
+        if (!CI) {
+            return false;
+        }
+        unsigned field = CI->getZExtValue();
+        Pointee next = {base.G,
+                        base.offset +
+                            m_DL.getStructLayout(ST)->getElementOffset(field),
+                        base.C->getAggregateElement(field)};
+        return next.C && descend(next, GEP, idx + 1, out);
+    }
+    ArrayType *AT = dyn_cast<ArrayType>(T);
+    if (!AT) {
+        return false;
+    }
+    uint64_t eltSize = m_DL.getTypeAllocSize(AT->getElementType());
+    uint64_t first = 0, last = AT->getNumElements();
+    if (CI) {
+        first = CI->getZExtValue();
+        last = first + 1;
+    }
+    for (uint64_t i = first; i < last && i < AT->getNumElements(); ++i) {
+        Pointee next = {base.G, base.offset + i * eltSize,
+                        base.C->getAggregateElement(i)};
+        if (!next.C || !descend(next, GEP, idx + 1, out)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Find the constants ptr may point to, if it only ever points into
+ * never-written parts of tables
+ *
+ * @param ptr
+ * @param out
+ * @param depth
+ *
+ * @return false if ptr can't be resolved from initializers
+ */
+bool DispatchTables::resolvePointees(Value *ptr, SmallVectorImpl<Pointee> &out,
+                                     unsigned depth) {
+    if (depth > MAX_DEPTH) {
+        return false;
+    }
+    ptr = ptr->stripPointerCasts();
+    if (GlobalVariable *G = dyn_cast<GlobalVariable>(ptr)) {
+        if (!isTable(G)) {
+            return false;
+        }
+        Pointee P = {G, 0, G->getInitializer()};
+        out.push_back(P);
+        return true;
+    }
+    if (GEPOperator *GEP = dyn_cast<GEPOperator>(ptr)) {
+        // Only GEPs into the object itself, not to a neighbouring one
+        ConstantInt *first = dyn_cast<ConstantInt>(GEP->getOperand(1));
+        if (!first || !first->isZero()) {
+            return false;
+        }
+        SmallVector<Pointee, 8> bases;
+        if (!resolvePointees(GEP->getPointerOperand(), bases, depth + 1)) {
+            return false;
+        }
+        for (const Pointee &base : bases) {
+            if (!descend(base, GEP, 2, out)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (LoadInst *LI = dyn_cast<LoadInst>(ptr)) {
+        // The loaded pointer is one of the constants in the loaded slots
+        SmallVector<Pointee, 8> slots;
+        if (!resolvePointees(LI->getPointerOperand(), slots, depth + 1)) {
+            return false;
+        }
+        uint64_t size = m_DL.getTypeStoreSize(LI->getType());
+        for (const Pointee &slot : slots) {
+            if (!isReadOnly(slot.G, slot.offset, size)) {
+                return false;
+            }
+            if (slot.C->isNullValue() || isa<UndefValue>(slot.C)) {
+                continue;
+            }
+            if (!resolvePointees(slot.C, out, depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Resolve the targets of an indirect call whose callee is loaded from
+ * never-written table slots
+ *
+ * @param callee Called operand of the call
+ * @param targets
+ *
+ * @return false if the callee isn't loaded from such slots
+ */
+bool DispatchTables::resolveCallees(Value *callee,
+                                    SmallSetVector<Function *, 8> &targets) {
+    LoadInst *LI = dyn_cast<LoadInst>(callee->stripPointerCasts());
+    if (!LI) {
+        return false;
+    }
+    SmallVector<Pointee, 8> slots;
+    if (!resolvePointees(LI->getPointerOperand(), slots, 0)) {
+        return false;
+    }
+    uint64_t size = m_DL.getTypeStoreSize(LI->getType());
+    SmallSetVector<Function *, 8> found;
+    for (const Pointee &slot : slots) {
+        if (!isReadOnly(slot.G, slot.offset, size)) {
+            return false;
+        }
+        if (slot.C->isNullValue() || isa<UndefValue>(slot.C)) {
+            continue;
+        }
+        Function *F = dyn_cast<Function>(slot.C->stripPointerCasts());
+        if (!F) {
+            return false;
+        }
+        found.insert(F);
+    }
+    targets.insert(found.begin(), found.end());
+    return true;
+}
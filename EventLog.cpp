@@ -0,0 +1,173 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <CSRWriter.hpp>
+#include <EventLog.hpp>
+
+#include <llvm/Support/MathExtras.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <cstring>
+
+using namespace llvm;
+
+static const char *const MAGIC = "MVXEVLG1";
+
+/**
+ * @brief Allocate the ring up front, nothing is allocated per event after
+ * this apart from numbering new values
+ *
+ * @param capacity Events kept, rounded up to a power of two
+ */
+EventLog::EventLog(unsigned capacity)
+    : m_ring(PowerOf2Ceil(std::max(capacity, 1u))),
+      m_mask(m_ring.size() - 1), m_recorded(0), m_values(1, nullptr) {}
+
+StringRef EventLog::typeName(Type T) {
+    switch (T) {
+    case VisitFunction:
+        return "visit-function";
+    case VisitLoad:
+        return "visit-load";
+    case VisitCall:
+        return "visit-call";
+    case LoadAlias:
+        return "load-alias";
+    case GEPSet:
+        return "gep-set";
+    case GEPValue:
+        return "gep-value";
+    case NotConstant:
+        return "not-constant";
+    case NoParent:
+        return "no-parent";
+    case GEPParent:
+        return "gep-parent";
+    case RangeParent:
+        return "range-parent";
+    case RangePastEnd:
+        return "range-past-end";
+    case HeapParent:
+        return "heap-parent";
+    case TargetGlobal:
+        return "target-global";
+    case NUM_TYPES:
+        break;
+    }
+    llvm_unreachable("Unknown event type!");
+}
+
+/**
+ * @brief Write the events still in the ring, oldest first, and the names of
+ * every value numbered
+ *
+ * @param OS
+ * @param ids
+ */
+void EventLog::write(raw_ostream &OS, StableValueIds &ids) const {
+    uint64_t kept = std::min<uint64_t>(m_recorded, m_ring.size());
+    std::vector<uint32_t> types, values, others;
+    std::vector<uint64_t> numbers;
+    for (uint64_t i = m_recorded - kept; i < m_recorded; ++i) {
+        const Event &E = m_ring[i & m_mask];
+        types.push_back(E.type);
+        values.push_back(E.value);
+        others.push_back(E.other);
+        numbers.push_back(E.number);
+    }
+
+    std::vector<std::string> names(1);
+    for (unsigned i = 1; i < m_values.size(); ++i) {
+        std::string name = ids.getId(m_values[i]);
+        if (name.empty()) {
+            raw_string_ostream printed(name);
+            m_values[i]->printAsOperand(printed, true);
+        }
+        names.push_back(name);
+    }
+    std::vector<uint64_t> nameStart;
+    std::string nameBlob;
+    CSRWriter::appendStrings(names, nameStart, nameBlob);
+
+    CSRWriter writer(OS);
+    writer.writeMagic(MAGIC);
+    writer.writeArray(ArrayRef<uint64_t>{kept, m_recorded - kept,
+                                         names.size(), nameBlob.size()});
+    writer.writeArray(types);
+    writer.writeArray(values);
+    writer.writeArray(others);
+    writer.writeArray(numbers);
+    writer.writeArray(nameStart);
+    writer.writeBlob(nameBlob);
+}
+
+/**
+ * @brief Read a log written by write
+ *
+ * @return false if the file can't be read or is malformed, with error set
+ */
+bool EventLog::read(StringRef path, Contents &contents, std::string &error) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> buf = MemoryBuffer::getFile(path);
+    if (!buf) {
+        error = "can't read " + path.str() + ": " + buf.getError().message();
+        return false;
+    }
+    StringRef data = (*buf)->getBuffer();
+    uint64_t pos = 0;
+    auto align = [](uint64_t size) { return (size + 7) & ~(uint64_t)7; };
+    // Reads count elements of T at pos, then skips the padding
+    auto column = [&](auto *out, uint64_t count) {
+        uint64_t size = count * sizeof(*out);
+        if (pos + size > data.size()) {
+            return false;
+        }
+        std::memcpy(out, data.data() + pos, size);
+        pos += align(size);
+        return true;
+    };
+
+    uint64_t header[4];
+    if (data.size() < 8 || !data.startswith(MAGIC)) {
+        error = path.str() + " is not an event log";
+        return false;
+    }
+    pos = 8;
+    if (!column(header, 4)) {
+        error = path.str() + " is truncated";
+        return false;
+    }
+    uint64_t numEvents = header[0], numValues = header[2];
+    std::vector<uint32_t> types(numEvents), values(numEvents),
+        others(numEvents);
+    std::vector<uint64_t> numbers(numEvents), nameStart(numValues + 1);
+    if (!column(types.data(), numEvents) ||
+        !column(values.data(), numEvents) ||
+        !column(others.data(), numEvents) ||
+        !column(numbers.data(), numEvents) ||
+        !column(nameStart.data(), numValues + 1) ||
+        pos + header[3] > data.size()) {
+        error = path.str() + " is truncated";
+        return false;
+    }
+    StringRef blob = data.substr(pos, header[3]);
+
+    contents.dropped = header[1];
+    contents.names.clear();
+    for (uint64_t i = 0; i < numValues; ++i) {
+        if (nameStart[i] >= blob.size()) {
+            error = path.str() + " has a bad name table";
+            return false;
+        }
+        contents.names.push_back(
+            blob.substr(nameStart[i]).split('\0').first.str());
+    }
+    contents.events.clear();
+    for (uint64_t i = 0; i < numEvents; ++i) {
+        if (types[i] >= NUM_TYPES || values[i] >= numValues ||
+            others[i] >= numValues) {
+            error = path.str() + " has a bad event";
+            return false;
+        }
+        contents.events.push_back(
+            {(Type)types[i], values[i], others[i], numbers[i]});
+    }
+    return true;
+}
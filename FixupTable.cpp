@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <FixupTable.hpp>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/GlobalVariable.h>
+
+using namespace llvm;
+
+FixupTable::FixupTable(const RelocationSet &relocations, const DataLayout &DL)
+    : m_relocations(relocations), m_DL(DL) {
+    auto addGlobal = [&](unsigned index) -> std::set<uint64_t> & {
+        auto inserted = m_slots.insert(
+            std::make_pair(index, std::set<uint64_t>()));
+        if (inserted.second) {
+            GlobalVariable *G = relocations.getGlobal(index);
+            const std::vector<uint64_t> &typeSlots =
+                pointerSlots(G->getValueType());
+            inserted.first->second.insert(typeSlots.begin(), typeSlots.end());
+        }
+        return inserted.first->second;
+    };
+    for (const RelocationSet::Record_t &R : relocations) {
+        std::set<uint64_t> &slots = addGlobal(R.first);
+        if (mayHoldPointer(relocations.getGlobal(R.first)->getValueType(),
+                           R.second)) {
+            slots.insert(R.second);
+        }
+    }
+    for (const RelocationSet::Range_t &R : relocations.ranges()) {
+        std::set<uint64_t> &slots = addGlobal(R.global);
+        Type *T = relocations.getGlobal(R.global)->getValueType();
+        for (uint64_t i = 0; i < R.count; ++i) {
+            uint64_t offset = R.start + i * R.stride + R.fieldOffset;
+            if (mayHoldPointer(T, offset)) {
+                slots.insert(offset);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Can a pointer be stored at offset within an object of type T: a
+ * pointer starts there, or it is untyped storage, bytes or a union
+ *
+ * @param T
+ * @param offset
+ *
+ * @return false for non-pointer scalars, padding and partial pointers
+ */
+bool FixupTable::mayHoldPointer(Type *T, uint64_t offset) const {
+    if (T->isPointerTy()) {
+        return offset == 0;
+    }
+    if (T->isIntegerTy(8)) {
+        return true;
+    }
+    if (StructType *ST = dyn_cast<StructType>(T)) {
+        // Unions are lowered to their largest member, which needn't be the
+        // pointer one
+        if (ST->hasName() && ST->getName().startswith("union.")) {
+            return true;
+        }
+        if (ST->isOpaque()) {
+            return false;
+        }
+        const StructLayout *SL = m_DL.getStructLayout(ST);
+        if (offset >= SL->getSizeInBytes()) {
+            return false;
+        }
+        unsigned i = SL->getElementContainingOffset(offset);
+        uint64_t start = SL->getElementOffset(i);
+        Type *elementTy = ST->getElementType(i);
+        if (offset - start >= m_DL.getTypeAllocSize(elementTy)) {
+            // Padding after the element
+            return false;
+        }
+        return mayHoldPointer(elementTy, offset - start);
+    }
+    if (ArrayType *AT = dyn_cast<ArrayType>(T)) {
+        uint64_t stride = m_DL.getTypeAllocSize(AT->getElementType());
+        if (!stride || offset >= stride * AT->getNumElements()) {
+            return false;
+        }
+        return mayHoldPointer(AT->getElementType(), offset % stride);
+    }
+    if (FixedVectorType *VT = dyn_cast<FixedVectorType>(T)) {
+        uint64_t stride = m_DL.getTypeAllocSize(VT->getElementType());
+        return stride && mayHoldPointer(VT->getElementType(), offset % stride);
+    }
+    return false;
+}
+
+/**
+ * @brief Offsets of the pointers within an object of type T
+ *
+ * @param T
+ *
+ * @return Sorted offsets, empty if T holds no pointers
+ */
+const std::vector<uint64_t> &FixupTable::pointerSlots(Type *T) {
+    auto it = m_typeSlots.find(T);
+    if (it != m_typeSlots.end()) {
+        return it->second;
+    }
+    std::vector<uint64_t> slots;
+    if (T->isPointerTy()) {
+        slots.push_back(0);
+    } else if (StructType *ST = dyn_cast<StructType>(T)) {
+        const StructLayout *SL = m_DL.getStructLayout(ST);
+        for (unsigned i = 0; i < ST->getNumElements(); ++i) {
+            // Copied, the recursive call may grow the map
+            std::vector<uint64_t> fieldSlots =
+                pointerSlots(ST->getElementType(i));
+            for (uint64_t slot : fieldSlots) {
+                slots.push_back(SL->getElementOffset(i) + slot);
+            }
+        }
+    } else if (ArrayType *AT = dyn_cast<ArrayType>(T)) {
+        std::vector<uint64_t> elementSlots =
+            pointerSlots(AT->getElementType());
+        uint64_t stride = m_DL.getTypeAllocSize(AT->getElementType());
+        if (!elementSlots.empty()) {
+            slots.reserve(elementSlots.size() * AT->getNumElements());
+            for (uint64_t i = 0; i < AT->getNumElements(); ++i) {
+                for (uint64_t slot : elementSlots) {
+                    slots.push_back(i * stride + slot);
+                }
+            }
+        }
+    } else if (FixedVectorType *VT = dyn_cast<FixedVectorType>(T)) {
+        if (VT->getElementType()->isPointerTy()) {
+            uint64_t stride = m_DL.getTypeAllocSize(VT->getElementType());
+            for (unsigned i = 0; i < VT->getNumElements(); ++i) {
+                slots.push_back(i * stride);
+            }
+        }
+    }
+    return m_typeSlots[T] = std::move(slots);
+}
+
+/**
+ * @brief Write one "name,size,offset,offset,..." line per relocated global,
+ * in module order, offsets sorted. Slots that don't fit a whole pointer in
+ * the global are dropped.
+ *
+ * @param OS Buffered stream to write to
+ */
+void FixupTable::write(raw_ostream &OS) const {
+    for (const auto &entry : m_slots) {
+        GlobalVariable *G = m_relocations.getGlobal(entry.first);
+        uint64_t size = m_DL.getTypeAllocSize(G->getValueType());
+        uint64_t pointerSize = m_DL.getPointerSize();
+        OS << G->getName() << "," << size;
+        for (uint64_t slot : entry.second) {
+            if (slot + pointerSize <= size) {
+                OS << "," << slot;
+            }
+        }
+        OS << "\n";
+    }
+}
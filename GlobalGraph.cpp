@@ -0,0 +1,221 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <CSRWriter.hpp>
+#include <GlobalGraph.hpp>
+#include <PointerBase.hpp>
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+
+#define DEBUG_TYPE "mvxaa"
+
+using namespace llvm;
+
+GlobalGraph::GlobalGraph(Module &M, const RelocationSet &relocations,
+                         const SetVector<Value *> &targets, AliasFn_t mayAlias)
+    : m_relocations(relocations), m_targets(targets), m_mayAlias(mayAlias),
+      m_DL(M.getDataLayout()) {
+    indexAccesses(M);
+
+    std::vector<unsigned> worklist;
+    std::set<unsigned> seen;
+    for (const RelocationSet::Record_t &R : relocations) {
+        if (seen.insert(R.first).second) {
+            worklist.push_back(R.first);
+        }
+    }
+    for (const RelocationSet::Range_t &R : relocations.ranges()) {
+        if (seen.insert(R.global).second) {
+            worklist.push_back(R.global);
+        }
+    }
+    while (!worklist.empty()) {
+        unsigned global = worklist.back();
+        worklist.pop_back();
+        Slot_t first(global, 0), last(global, UINT64_MAX);
+        for (auto it = m_initial.lower_bound(first),
+                  end = m_initial.upper_bound(last);
+             it != end; ++it) {
+            addTargets(it->first, it->second);
+        }
+        for (auto it = m_accesses.lower_bound(first),
+                  end = m_accesses.upper_bound(last);
+             it != end; ++it) {
+            // Flow-insensitively a load sees everything stored to the slot,
+            // one is enough
+            for (Value *V : it->second) {
+                addTargets(it->first, V);
+                if (isa<LoadInst>(V)) {
+                    break;
+                }
+            }
+        }
+        for (auto it = m_edges.lower_bound(first),
+                  end = m_edges.upper_bound(last);
+             it != end; ++it) {
+            for (unsigned target : it->second) {
+                if (seen.insert(target).second) {
+                    worklist.push_back(target);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Find every pointer loaded from or stored to a constant offset of a
+ * global, and the constant pointers in initializers
+ *
+ * @param M
+ */
+void GlobalGraph::indexAccesses(Module &M) {
+    DenseMap<const Value *, unsigned> globalIndex;
+    for (GlobalVariable &G : M.globals()) {
+        unsigned index = globalIndex.size();
+        globalIndex[&G] = index;
+        if (G.hasDefinitiveInitializer()) {
+            indexInitializer(index, G.getInitializer(), 0);
+        }
+    }
+
+    std::map<Slot_t, std::vector<Value *>> stores;
+    for (Function &F : M) {
+        for (Instruction &I : instructions(F)) {
+            Value *ptr = nullptr;
+            Value *V = nullptr;
+            if (LoadInst *LI = dyn_cast<LoadInst>(&I)) {
+                ptr = LI->getPointerOperand();
+                V = LI;
+            } else if (StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+                ptr = SI->getPointerOperand();
+                V = SI->getValueOperand();
+            }
+            if (!V || !V->getType()->isPointerTy()) {
+                continue;
+            }
+            SmallVector<PointerBase, 4> bases;
+            decomposePointer(ptr, m_DL, bases);
+            for (const PointerBase &B : bases) {
+                auto it = globalIndex.find(B.base);
+                if (!B.isConstant() || it == globalIndex.end()) {
+                    continue;
+                }
+                Slot_t slot(it->second, B.offset);
+                (isa<LoadInst>(V) ? m_accesses[slot] : stores[slot])
+                    .push_back(V);
+            }
+        }
+    }
+    for (auto &slotStores : stores) {
+        std::vector<Value *> &values = m_accesses[slotStores.first];
+        values.insert(values.end(), slotStores.second.begin(),
+                      slotStores.second.end());
+    }
+}
+
+void GlobalGraph::indexInitializer(unsigned global, Constant *C,
+                                   uint64_t offset) {
+    Type *T = C->getType();
+    if (T->isPointerTy()) {
+        if (!C->isNullValue() && !isa<UndefValue>(C)) {
+            m_initial[Slot_t(global, offset)] = C;
+        }
+    } else if (StructType *ST = dyn_cast<StructType>(T)) {
+        const StructLayout *SL = m_DL.getStructLayout(ST);
+        for (unsigned i = 0; i < ST->getNumElements(); ++i) {
+            if (Constant *field = C->getAggregateElement(i)) {
+                indexInitializer(global, field,
+                                 offset + SL->getElementOffset(i));
+            }
+        }
+    } else if (ArrayType *AT = dyn_cast<ArrayType>(T)) {
+        if (isa<ConstantAggregateZero>(C) || isa<ConstantDataSequential>(C)) {
+            // Nothing, or no pointers
+            return;
+        }
+        uint64_t stride = m_DL.getTypeAllocSize(AT->getElementType());
+        for (uint64_t i = 0; i < AT->getNumElements(); ++i) {
+            if (Constant *element = C->getAggregateElement(i)) {
+                indexInitializer(global, element, offset + i * stride);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Add the globals V may point to as targets of slot
+ *
+ * @param slot
+ * @param V Pointer held in the slot
+ */
+void GlobalGraph::addTargets(const Slot_t &slot, Value *V) {
+    std::set<unsigned> &edges = m_edges[slot];
+    if (Constant *C = dyn_cast<Constant>(V)) {
+        // Initializers and constant stores are exact
+        SmallVector<PointerBase, 1> bases;
+        decomposePointer(C, m_DL, bases);
+        for (const PointerBase &B : bases) {
+            if (isa<GlobalVariable>(B.base) && m_targets.count(B.base)) {
+                edges.insert(m_relocations.getIndex(B.base));
+            }
+        }
+        return;
+    }
+    for (Value *target : m_targets) {
+        if (m_mayAlias(V, target)) {
+            edges.insert(m_relocations.getIndex(target));
+        }
+    }
+}
+
+size_t GlobalGraph::numEdges() const {
+    size_t edges = 0;
+    for (const auto &slot : m_edges) {
+        edges += slot.second.size();
+    }
+    return edges;
+}
+
+/**
+ * @brief Write the graph, layout in runtime/mvx_graph.h. Slots without
+ * targets are left out.
+ *
+ * @param OS
+ */
+void GlobalGraph::writeBinary(raw_ostream &OS) const {
+    unsigned numNodes = m_relocations.numGlobals();
+    std::vector<uint64_t> slotStart, slotOffset, edgeStart;
+    std::vector<uint32_t> edgeTarget;
+    std::vector<std::string> names;
+    auto slotIt = m_edges.begin();
+    for (unsigned node = 0; node < numNodes; ++node) {
+        slotStart.push_back(slotOffset.size());
+        for (; slotIt != m_edges.end() && slotIt->first.first == node;
+             ++slotIt) {
+            if (slotIt->second.empty()) {
+                continue;
+            }
+            slotOffset.push_back(slotIt->first.second);
+            edgeStart.push_back(edgeTarget.size());
+            edgeTarget.insert(edgeTarget.end(), slotIt->second.begin(),
+                              slotIt->second.end());
+        }
+        names.push_back(m_relocations.getGlobal(node)->getName().str());
+    }
+    slotStart.push_back(slotOffset.size());
+    edgeStart.push_back(edgeTarget.size());
+    std::vector<uint64_t> nameStart;
+    std::string nameBlob;
+    CSRWriter::appendStrings(names, nameStart, nameBlob);
+
+    CSRWriter writer(OS);
+    writer.writeMagic("MVXGRPH1");
+    writer.writeArray(ArrayRef<uint64_t>{numNodes, slotOffset.size(),
+                                         edgeTarget.size(), nameBlob.size()});
+    writer.writeArray(slotStart);
+    writer.writeArray(slotOffset);
+    writer.writeArray(edgeStart);
+    writer.writeArray(edgeTarget);
+    writer.writeArray(nameStart);
+    writer.writeBlob(nameBlob);
+}
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <HeapSites.hpp>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/InstIterator.h>
+
+using namespace llvm;
+
+/**
+ * @brief Collect every call to one of the allocators that returns the new
+ * object, in module order
+ *
+ * @param M
+ * @param allocators
+ */
+HeapSites::HeapSites(Module &M, const AllocSpec &allocators)
+    : m_allocators(allocators) {
+    for (Function &F : M) {
+        if (allocators.isSolveClone(&F)) {
+            // Copy of an initializing wrapper, its sites are the wrapper's
+            continue;
+        }
+        for (Instruction &I : instructions(F)) {
+            CallBase *CB = dyn_cast<CallBase>(&I);
+            if (!CB || !CB->getType()->isPointerTy()) {
+                continue;
+            }
+            Function *callee = dyn_cast<Function>(
+                CB->getCalledOperand()->stripPointerCasts());
+            const AllocSpec::Entry *E =
+                callee ? allocators.lookup(callee->getName()) : nullptr;
+            if (E && E->allocArg == AllocSpec::RETURN_VALUE) {
+                m_siteIndex[CB] = m_sites.size();
+                m_sites.push_back(CB);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Add a (site, offset) record, duplicates are ignored
+ *
+ * @param site Must be one of getSites()
+ * @param offset
+ *
+ * @return true if the record wasn't already there
+ */
+bool HeapSites::insert(CallBase *site, unsigned offset) {
+    auto it = m_siteIndex.find(site);
+    assert(it != m_siteIndex.end() && "Not a known allocation site!");
+    return m_records.insert(Record_t(it->second, offset)).second;
+}
+
+/**
+ * @brief Write "site id,allocator,offset,size" lines in sorted order, size
+ * is left empty unless the allocation size is a constant
+ *
+ * @param OS
+ * @param ids
+ */
+void HeapSites::write(raw_ostream &OS, StableValueIds &ids) const {
+    for (const Record_t &R : m_records) {
+        CallBase *site = m_sites[R.first];
+        StringRef allocator =
+            site->getCalledOperand()->stripPointerCasts()->getName();
+        OS << ids.getId(site) << "," << allocator << "," << R.second << ",";
+        const AllocSpec::Entry *E = m_allocators.lookup(allocator);
+        if (E && E->sizeArg != AllocSpec::UNKNOWN_SIZE &&
+            (unsigned)E->sizeArg < site->arg_size()) {
+            if (ConstantInt *CI =
+                    dyn_cast<ConstantInt>(site->getArgOperand(E->sizeArg))) {
+                OS << CI->getZExtValue();
+            }
+        }
+        OS << "\n";
+    }
+}
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <CSRWriter.hpp>
+#include <IndirectCallTargets.hpp>
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Metadata.h>
+
+#include <algorithm>
+
+using namespace llvm;
+
+const char *const IndirectCallTargets::CALLSITE_MD = "mvx.callsite";
+
+static bool byName(const Function *A, const Function *B) {
+    return A->getName() < B->getName();
+}
+
+IndirectCallTargets::IndirectCallTargets(Module &M, StableValueIds &ids,
+                                         MayCallFn_t mayCall)
+    : m_ids(ids), m_mayCall(mayCall) {
+    for (Function &F : M) {
+        if (!F.isIntrinsic() && F.hasAddressTaken()) {
+            m_candidates.push_back(&F);
+        }
+    }
+    std::sort(m_candidates.begin(), m_candidates.end(), byName);
+}
+
+/**
+ * @brief Record an indirect call site, adding a site twice is harmless
+ *
+ * @param CI
+ * @param known Targets already known exactly, e.g. from a constant dispatch
+ * table, the candidates aren't queried then
+ */
+void IndirectCallTargets::addSite(CallInst *CI, ArrayRef<Function *> known) {
+    std::string id = m_ids.getId(CI);
+    if (m_sites.count(id)) {
+        return;
+    }
+    Site &S = m_sites[id];
+    S.call = CI;
+    if (!known.empty()) {
+        S.targets.assign(known.begin(), known.end());
+        std::sort(S.targets.begin(), S.targets.end(), byName);
+        return;
+    }
+    // C code calls through casted pointers, so only the arity is checked
+    unsigned numArgs = CI->arg_size();
+    for (Function *F : m_candidates) {
+        FunctionType *FT = F->getFunctionType();
+        if ((FT->getNumParams() == numArgs ||
+             (FT->isVarArg() && FT->getNumParams() <= numArgs)) &&
+            m_mayCall(CI->getCalledOperand(), F)) {
+            S.targets.push_back(F);
+        }
+    }
+}
+
+/**
+ * @brief Each site with its targets, in site order
+ */
+std::vector<std::pair<CallInst *, ArrayRef<Function *>>>
+IndirectCallTargets::sites() const {
+    std::vector<std::pair<CallInst *, ArrayRef<Function *>>> result;
+    for (const auto &site : m_sites) {
+        result.push_back(std::make_pair(site.second.call,
+                                        ArrayRef<Function *>(
+                                            site.second.targets)));
+    }
+    return result;
+}
+
+size_t IndirectCallTargets::numTargets() const {
+    size_t total = 0;
+    for (const auto &site : m_sites) {
+        total += site.second.targets.size();
+    }
+    return total;
+}
+
+/**
+ * @brief Write the sites as CSR: site -> indices of its targets, sorted, into
+ * the table of functions that are the target of any site, sorted by name
+ *
+ * @param OS
+ */
+void IndirectCallTargets::writeBinary(raw_ostream &OS) const {
+    std::vector<Function *> functions;
+    for (const auto &site : m_sites) {
+        functions.insert(functions.end(), site.second.targets.begin(),
+                         site.second.targets.end());
+    }
+    std::sort(functions.begin(), functions.end(), byName);
+    functions.erase(std::unique(functions.begin(), functions.end()),
+                    functions.end());
+
+    std::vector<uint64_t> targetStart;
+    std::vector<uint32_t> targets;
+    std::vector<std::string> names;
+    for (const auto &site : m_sites) {
+        targetStart.push_back(targets.size());
+        for (Function *F : site.second.targets) {
+            targets.push_back(std::lower_bound(functions.begin(),
+                                               functions.end(), F, byName) -
+                              functions.begin());
+        }
+        names.push_back(site.first);
+    }
+    targetStart.push_back(targets.size());
+    for (Function *F : functions) {
+        names.push_back(F->getName().str());
+    }
+    std::vector<uint64_t> nameStart;
+    std::string nameBlob;
+    CSRWriter::appendStrings(names, nameStart, nameBlob);
+
+    CSRWriter writer(OS);
+    writer.writeMagic("MVXCALL1");
+    writer.writeArray(ArrayRef<uint64_t>{m_sites.size(), targets.size(),
+                                         functions.size(), nameBlob.size()});
+    writer.writeArray(targetStart);
+    writer.writeArray(targets);
+    writer.writeArray(nameStart);
+    writer.writeBlob(nameBlob);
+}
+
+/**
+ * @brief Give each site its number as !mvx.callsite !{i64 site}
+ */
+void IndirectCallTargets::attachMetadata() const {
+    uint64_t index = 0;
+    for (const auto &site : m_sites) {
+        CallInst *CI = site.second.call;
+        LLVMContext &C = CI->getContext();
+        Constant *number = ConstantInt::get(Type::getInt64Ty(C), index++);
+        CI->setMetadata(CALLSITE_MD,
+                        MDTuple::get(C, {ConstantAsMetadata::get(number)}));
+    }
+}
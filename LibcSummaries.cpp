@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <LibcSummaries.hpp>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
+
+using namespace llvm;
+
+#define NONE -1
+
+// clang-format off
+static const LibcSummary LIBC_SUMMARIES[] = {
+    // name             read  write callback data                ret   svf
+    {"memcpy",          1,    0,    NONE, {NONE, NONE, NONE},  0,    true},
+    {"memmove",         1,    0,    NONE, {NONE, NONE, NONE},  0,    true},
+    {"bcopy",           0,    1,    NONE, {NONE, NONE, NONE},  NONE, true},
+    {"memset",          NONE, 0,    NONE, {NONE, NONE, NONE},  0,    true},
+    {"bzero",           NONE, 0,    NONE, {NONE, NONE, NONE},  NONE, true},
+    {"strcpy",          1,    0,    NONE, {NONE, NONE, NONE},  0,    true},
+    {"strncpy",         1,    0,    NONE, {NONE, NONE, NONE},  0,    true},
+    {"strcat",          1,    0,    NONE, {NONE, NONE, NONE},  0,    true},
+    {"strncat",         1,    0,    NONE, {NONE, NONE, NONE},  0,    true},
+    {"strlcpy",         1,    0,    NONE, {NONE, NONE, NONE},  NONE, true},
+    {"strlcat",         1,    0,    NONE, {NONE, NONE, NONE},  NONE, true},
+    {"strchr",          NONE, NONE, NONE, {NONE, NONE, NONE},  0,    true},
+    {"strrchr",         NONE, NONE, NONE, {NONE, NONE, NONE},  0,    true},
+    {"strstr",          NONE, NONE, NONE, {NONE, NONE, NONE},  0,    true},
+    {"memchr",          NONE, NONE, NONE, {NONE, NONE, NONE},  0,    true},
+    {"qsort",           0,    0,    3,    {0,    0,    NONE},  NONE, false},
+    {"qsort_r",         0,    0,    3,    {0,    0,    4},     NONE, false},
+    {"bsearch",         1,    NONE, 4,    {0,    1,    NONE},  1,    false},
+    {"lfind",           1,    NONE, 4,    {0,    1,    NONE},  1,    false},
+    {"lsearch",         1,    1,    4,    {0,    1,    NONE},  1,    false},
+    {"tsearch",         1,    1,    2,    {0,    NONE, NONE},  NONE, false},
+    {"tfind",           1,    NONE, 2,    {0,    NONE, NONE},  NONE, false},
+    {"twalk",           0,    NONE, 1,    {NONE, NONE, NONE},  NONE, false},
+    {"atexit",          NONE, NONE, 0,    {NONE, NONE, NONE},  NONE, false},
+    {"on_exit",         NONE, NONE, 0,    {NONE, 1,    NONE},  NONE, false},
+    {"signal",          NONE, NONE, 1,    {NONE, NONE, NONE},  1,    false},
+    {"bsd_signal",      NONE, NONE, 1,    {NONE, NONE, NONE},  1,    false},
+    {"pthread_once",    NONE, 0,    1,    {NONE, NONE, NONE},  NONE, false},
+    {"pthread_create",  NONE, 0,    2,    {3,    NONE, NONE},  NONE, true},
+    {"pthread_atfork",  NONE, NONE, 0,    {NONE, NONE, NONE},  NONE, false},
+};
+// clang-format on
+
+/**
+ * @brief Find the summary of a library function, memory intrinsics
+ * (llvm.memcpy.* etc.) share the summary of their libc counterpart
+ *
+ * @param name
+ *
+ * @return nullptr if the function isn't summarized
+ */
+const LibcSummary *lookupLibcSummary(StringRef name) {
+    static const StringMap<const LibcSummary *> summaries = [] {
+        StringMap<const LibcSummary *> map;
+        for (const LibcSummary &S : LIBC_SUMMARIES) {
+            map[S.name] = &S;
+        }
+        return map;
+    }();
+    if (name.consume_front("llvm.")) {
+        name = name.split('.').first;
+    }
+    return summaries.lookup(name);
+}
+
+/**
+ * @brief Model of a summarized function with the signature it is called
+ * with: calls the callback with the summarized arguments and returns the
+ * summarized argument, if any
+ *
+ * @param M
+ * @param S
+ * @param FT Type of the calls being redirected
+ *
+ * @return
+ */
+Function *LibcModels::getOrCreateModel(Module &M, const LibcSummary &S,
+                                       FunctionType *FT) {
+    Function *&model = m_modelsByType[std::make_pair(&S, FT)];
+    if (model) {
+        return model;
+    }
+    model = Function::Create(FT, GlobalValue::InternalLinkage,
+                             Twine("__mvx_model_") + S.name, M);
+    m_models.push_back(model);
+
+    IRBuilder<> builder(BasicBlock::Create(M.getContext(), "entry", model));
+    // Arguments keep their position in the callback's parameters, a slot
+    // with nothing passed on gets a null pointer
+    SmallVector<Value *, 3> cbArgs;
+    SmallVector<Type *, 3> cbArgTypes;
+    for (int data : S.callbackData) {
+        Value *arg = Constant::getNullValue(builder.getInt8PtrTy());
+        if (data != NONE && (unsigned)data < FT->getNumParams()) {
+            arg = model->getArg(data);
+        }
+        cbArgs.push_back(arg);
+        cbArgTypes.push_back(arg->getType());
+    }
+    while (!cbArgs.empty() && isa<Constant>(cbArgs.back())) {
+        cbArgs.pop_back();
+        cbArgTypes.pop_back();
+    }
+    Value *callback = model->getArg(S.callbackArg);
+    FunctionType *cbTy =
+        FunctionType::get(builder.getVoidTy(), cbArgTypes, false);
+    builder.CreateCall(
+        cbTy, builder.CreatePointerCast(callback, cbTy->getPointerTo()),
+        cbArgs);
+
+    Type *retTy = FT->getReturnType();
+    if (retTy->isVoidTy()) {
+        builder.CreateRetVoid();
+    } else if (S.returnArg != NONE && retTy->isPointerTy() &&
+               model->getArg(S.returnArg)->getType()->isPointerTy()) {
+        builder.CreateRet(
+            builder.CreatePointerCast(model->getArg(S.returnArg), retTy));
+    } else {
+        builder.CreateRet(Constant::getNullValue(retTy));
+    }
+    return model;
+}
+
+/**
+ * @brief Point calls of summarized callback-invoking functions that SVF
+ * doesn't model at generated models, until restoreAfterSolve
+ *
+ * @param M
+ */
+void LibcModels::redirectForSolve(Module &M) {
+    SmallVector<CallBase *, 16> calls;
+    for (Function &F : M) {
+        for (Instruction &I : instructions(F)) {
+            CallBase *CB = dyn_cast<CallBase>(&I);
+            Function *callee =
+                CB ? dyn_cast<Function>(CB->getCalledOperand()) : nullptr;
+            if (callee && callee->isDeclaration()) {
+                calls.push_back(CB);
+            }
+        }
+    }
+    for (CallBase *CB : calls) {
+        Function *callee = cast<Function>(CB->getCalledOperand());
+        const LibcSummary *S = lookupLibcSummary(callee->getName());
+        if (!S || S->svfModeled || S->callbackArg == NONE ||
+            (unsigned)S->callbackArg >= CB->arg_size()) {
+            continue;
+        }
+        m_redirected.push_back(std::make_pair(CB, callee));
+        CB->setCalledOperand(getOrCreateModel(M, *S, CB->getFunctionType()));
+    }
+}
+
+void LibcModels::restoreAfterSolve() {
+    for (auto &redirect : m_redirected) {
+        redirect.first->setCalledOperand(redirect.second);
+    }
+    m_redirected.clear();
+}
+
+/**
+ * @brief Erase the models. Only once the SVF state is gone, as it refers to
+ * their instructions.
+ */
+void LibcModels::release() {
+    for (Function *model : m_models) {
+        model->eraseFromParent();
+    }
+    m_models.clear();
+    m_modelsByType.clear();
+}
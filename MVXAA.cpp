@@ -2,6 +2,21 @@
 #include <CollectGlobals.hpp>
 #include <MVXAA.hpp>
 
+#include <llvm/IR/InstIterator.h>
+#include <llvm/Support/Errno.h>
+#include <llvm/Support/FileUtilities.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/Regex.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #define DEBUG_TYPE "mvxaa"
 #define USE_SET_SIZE (32)
 
@@ -10,9 +25,200 @@ using namespace llvm;
 cl::opt<std::string> MVX_FUNC("mvx-func", cl::desc("Specify function to guard"),
                               cl::value_desc("function name"));
 
+cl::opt<std::string>
+    MVX_RECORD_TRACE("mvx-record-trace",
+                     cl::desc("Record every global alias query to a file"),
+                     cl::value_desc("filename"));
+
+cl::opt<std::string> MVX_EVENT_LOG(
+    "mvx-event-log",
+    cl::desc("Record what the walk does to a binary event log, decode it "
+             "with tools/mvx-eventlog"),
+    cl::value_desc("filename"));
+
+cl::opt<unsigned> MVX_EVENT_LOG_SIZE(
+    "mvx-event-log-size",
+    cl::desc("Number of events -mvx-event-log keeps, older ones are dropped"),
+    cl::init(1 << 20));
+
+cl::opt<std::string> MVX_REPLAY_TRACE(
+    "mvx-replay-trace",
+    cl::desc("Re-execute a recorded query trace instead of walking the "
+             "guarded function, and check the results match"),
+    cl::value_desc("filename"));
+
+cl::opt<std::string> MVX_BASELINE(
+    "mvx-baseline",
+    cl::desc("Report how the relocation set changed against an earlier dump"),
+    cl::value_desc("dump file"));
+
+cl::opt<unsigned> MVX_BASELINE_MAX_GROWTH(
+    "mvx-baseline-max-growth",
+    cl::desc("Fail if the relocation set grew by more than this many records "
+             "against -mvx-baseline"),
+    cl::init(0));
+
+cl::opt<unsigned> MVX_MEM_BUDGET(
+    "mvx-mem-budget",
+    cl::desc("Soft resident memory limit in MB, past it the SVF state is "
+             "released and the rest of the guarded region is summarized "
+             "conservatively"),
+    cl::value_desc("MB"), cl::init(0));
+
+cl::opt<unsigned> MVX_DEADLINE(
+    "mvx-deadline",
+    cl::desc("Seconds the solve, and then the walk of each guarded region, "
+             "may run, past them the solve is killed or the rest of the "
+             "region summarized conservatively, and the result marked "
+             "degraded"),
+    cl::value_desc("seconds"), cl::init(0));
+
+static const char *const MEM_BUDGET_REASON = "memory budget";
+static const char *const DEADLINE_REASON = "deadline";
+
+cl::opt<std::string> MVX_CHECKPOINT(
+    "mvx-checkpoint",
+    cl::desc("Directory to save the points-to sets of a finished solve and "
+             "the progress of the guarded function walk to. A solve killed "
+             "before it finishes starts over"),
+    cl::value_desc("directory"));
+
+cl::opt<unsigned> MVX_CHECKPOINT_INTERVAL(
+    "mvx-checkpoint-interval",
+    cl::desc("Seconds between checkpoints of the walk, not taken with "
+             "-mvx-heap"),
+    cl::value_desc("seconds"), cl::init(300));
+
+cl::opt<bool> MVX_RESUME(
+    "mvx-resume",
+    cl::desc("Resume from the checkpoint in -mvx-checkpoint, if it was taken "
+             "on the same module"),
+    cl::init(false));
+
+cl::opt<bool> MVX_HEAP("mvx-heap",
+                       cl::desc("Also report heap allocation sites used by "
+                                "the guarded region"),
+                       cl::init(false));
+
+cl::list<std::string> MVX_ALLOC_FNS(
+    "mvx-alloc-fns",
+    cl::desc("Additional allocation functions for -mvx-heap"),
+    cl::value_desc("name,..."), cl::CommaSeparated);
+
+cl::opt<std::string> MVX_HEAP_DUMP("mvx-heap-dump",
+                                   cl::desc("Output file for -mvx-heap"),
+                                   cl::value_desc("filename"),
+                                   cl::init("heap_sites.dump"));
+
+cl::opt<std::string> MVX_ALLOC_SPEC(
+    "mvx-alloc-spec",
+    cl::desc("Allocation wrappers of the analyzed program, modeled as heap "
+             "allocators during the solve"),
+    cl::value_desc("spec file"));
+
+cl::opt<bool> MVX_SUMMARIES(
+    "mvx-summaries",
+    cl::desc("Answer from bottom-up per-function summaries instead of "
+             "walking the guarded function"),
+    cl::init(false));
+
+cl::list<std::string> MVX_SUMMARY_ENTRIES(
+    "mvx-summary-entries",
+    cl::desc("Also write the summaries of these candidate entry points, "
+             "implies -mvx-summaries"),
+    cl::value_desc("function,..."), cl::CommaSeparated);
+
+cl::opt<std::string>
+    MVX_SUMMARY_DUMP("mvx-summary-dump",
+                     cl::desc("Output file for -mvx-summary-entries"),
+                     cl::value_desc("filename"), cl::init("summaries.dump"));
+
+cl::opt<unsigned> MVX_SUMMARY_THREADS(
+    "mvx-summary-threads",
+    cl::desc("Threads propagating summaries, 0 to use all of them"),
+    cl::init(0));
+
+cl::opt<bool> MVX_EXPLORE(
+    "mvx-explore",
+    cl::desc("Rank every defined function as a guarded entry point by the "
+             "globals it would relocate, instead of analyzing -mvx-func"),
+    cl::init(false));
+
+cl::opt<std::string>
+    MVX_EXPLORE_FILTER("mvx-explore-filter",
+                       cl::desc("Only rank functions matching this regex"),
+                       cl::value_desc("regex"));
+
+cl::opt<std::string>
+    MVX_EXPLORE_DUMP("mvx-explore-dump",
+                     cl::desc("Output file for -mvx-explore"),
+                     cl::value_desc("filename"), cl::init("entry_costs.dump"));
+
+cl::opt<std::string> MVX_POLICY(
+    "mvx-policy",
+    cl::desc("Functions to skip or summarize, call depth and instruction "
+             "limits for the guarded function walk"),
+    cl::value_desc("policy file"));
+
+cl::opt<std::string>
+    MVX_POLICY_REPORT("mvx-policy-report",
+                      cl::desc("Output file listing what -mvx-policy pruned"),
+                      cl::value_desc("filename"),
+                      cl::init("policy_report.dump"));
+
+cl::opt<std::string> MVX_RANGES_DUMP(
+    "mvx-ranges-dump",
+    cl::desc("Output file for strided ranges of dynamically indexed arrays"),
+    cl::value_desc("filename"), cl::init("global_ranges.dump"));
+
+cl::opt<std::string> MVX_FIXUPS_DUMP(
+    "mvx-fixups-dump",
+    cl::desc("Output file for the pointer slots of each relocated global"),
+    cl::value_desc("filename"), cl::init("global_fixups.dump"));
+
+cl::opt<std::string> MVX_GRAPH(
+    "mvx-graph",
+    cl::desc("Export which globals the relocated globals' pointers may point "
+             "to, transitively, as an mmap-able CSR graph"),
+    cl::value_desc("filename"));
+
+cl::opt<std::string>
+    MVX_DUMP_FILE("mvx-dump-file",
+                  cl::desc("Output file for the relocation records, none if "
+                           "empty"),
+                  cl::value_desc("filename"),
+                  cl::init("global_addresses.dump"));
+
+cl::opt<bool> MVX_METADATA(
+    "mvx-metadata",
+    cl::desc("Attach the relocation records and ranges to the output module "
+             "as metadata, side files are then only written when asked for"),
+    cl::init(false));
+
+cl::opt<std::string> MVX_CALL_TARGETS(
+    "mvx-call-targets",
+    cl::desc("Export the functions each indirect call of the guarded region "
+             "may call, as an mmap-able CSR table"),
+    cl::value_desc("filename"));
+
+cl::opt<unsigned> MVX_PROMOTE_CALLS(
+    "mvx-promote-calls",
+    cl::desc("Rewrite indirect calls of the guarded region with at most this "
+             "many targets into compares and direct calls, 0 disables"),
+    cl::init(0));
+
+cl::opt<bool> MVX_DISPATCH_TABLES(
+    "mvx-dispatch-tables",
+    cl::desc("Resolve calls through never-written function pointer tables "
+             "from their initializers"),
+    cl::init(true));
+
 MVXAA::MVXAA()
     : ModulePass(ID), m_pglobals(), m_pwpa(), m_targetGEPSet(),
-      m_targetGlobals() {}
+      m_targetGlobals(), m_pguardedFunc(nullptr), m_pcurrentFunc(nullptr),
+      m_summarizing(false), m_summarizedFuncs(0), m_addedEscaped(false),
+      m_degradedReason(nullptr), m_killedSolve(false),
+      m_resumedSolve(false), m_collectingSummaries(false) {}
 
 /**
  * @brief We only have a single module, this assumes llvm-link has been called
@@ -23,45 +229,702 @@ MVXAA::MVXAA()
  * @return
  */
 bool MVXAA::runOnModule(Module &M) {
+    prepare(M, getAnalysis<CollectGlobals>().getResult());
+
+    if (!MVX_REPLAY_TRACE.empty()) {
+        if (m_summarizing) {
+            report_fatal_error("Can't replay a trace, the solve exceeded "
+                               "-mvx-mem-budget");
+        }
+        replayTrace(MVX_REPLAY_TRACE);
+        return false;
+    }
+    if (!MVX_RECORD_TRACE.empty()) {
+        std::error_code E;
+        auto traceFile = std::make_unique<raw_fd_ostream>(MVX_RECORD_TRACE, E);
+        if (E) {
+            report_fatal_error(Twine("Error opening trace file ") +
+                               MVX_RECORD_TRACE + ": " + E.message());
+        }
+        m_ptrace = std::make_unique<QueryTrace>(*m_pids, std::move(traceFile));
+    }
+    if (!MVX_EVENT_LOG.empty()) {
+        m_pevents = std::make_unique<EventLog>(MVX_EVENT_LOG_SIZE);
+    }
+
+    if (MVX_EXPLORE) {
+        exploreEntryPoints();
+        releaseSolverState();
+        return false;
+    }
+
+    Function *guardedFunc = M.getFunction(m_mvxFunc);
+    if (!guardedFunc) {
+        llvm_unreachable("Guarded function name doesn't match any functions");
+    }
+
+    analyzeGuarded(guardedFunc);
+
+    if (m_degradedReason == MEM_BUDGET_REASON) {
+        errs() << "MVXAA: memory budget of " << MVX_MEM_BUDGET
+               << "MB exceeded, summarized " << m_summarizedFuncs
+               << " functions conservatively\n";
+    } else if (m_degradedReason == DEADLINE_REASON) {
+        errs() << "MVXAA: deadline of " << MVX_DEADLINE << "s passed"
+               << (m_killedSolve ? " during the solve" : "")
+               << ", summarized " << m_summarizedFuncs
+               << " functions conservatively\n";
+    }
+
+    if (!MVX_POLICY.empty()) {
+        dumpPolicyReport();
+    }
+
+    // Now dump the data to file:
+    dumpGlobalsToFile(*m_pglobalsAndOffsets);
+    // Before promotion adds instructions and shifts the stable ids
+    if (m_pevents) {
+        writeEventLog();
+    }
+    if (m_pheapSites) {
+        dumpHeapSitesToFile();
+    }
+    if (!MVX_GRAPH.empty()) {
+        exportGlobalGraph();
+    }
+    if (!MVX_CALL_TARGETS.empty() || MVX_PROMOTE_CALLS) {
+        std::unique_ptr<IndirectCallTargets> callTargets =
+            collectCallTargets();
+        if (!MVX_CALL_TARGETS.empty()) {
+            exportCallTargets(*callTargets);
+        }
+        if (MVX_PROMOTE_CALLS) {
+            promoteIndirectCalls(*callTargets);
+        }
+    }
+    if (MVX_METADATA) {
+        m_pglobalsAndOffsets->attachMetadata(M);
+    }
+    m_ptrace.reset();
+
+    // All queries are done, nothing needs the solve past this point
+    releaseSolverState();
+
+    if (!MVX_BASELINE.empty()) {
+        diffAgainstBaseline(MVX_BASELINE);
+    }
+
+    return MVX_METADATA || MVX_PROMOTE_CALLS;
+}
+
+/**
+ * @brief Everything up to the walk: read the specs, solve and index the
+ * module. Done once, any number of guarded functions can then be analyzed
+ * against the same solve with analyzeGuarded.
+ *
+ * @param M
+ * @param globals The module's globals, as collected by CollectGlobals
+ */
+void MVXAA::prepare(Module &M, std::unique_ptr<SetVector<Value *>> globals) {
+    m_solveDeadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(MVX_DEADLINE);
+    m_walkDeadline = m_solveDeadline;
     // Take ownership of the globals
-    m_pglobals = getAnalysis<CollectGlobals>().getResult();
+    m_pglobals = std::move(globals);
     m_pmainmodule = &M;
+    m_pglobalsAndOffsets = std::make_unique<RelocationSet>(M);
+    for (const std::string &name : MVX_ALLOC_FNS) {
+        m_allocSpec.add(name, AllocSpec::RETURN_VALUE, AllocSpec::UNKNOWN_SIZE);
+    }
+    if (!MVX_POLICY.empty()) {
+        std::string error;
+        if (!m_policy.loadFile(MVX_POLICY, error)) {
+            report_fatal_error(Twine(error));
+        }
+    }
+    if (!MVX_ALLOC_SPEC.empty()) {
+        std::string error;
+        if (!m_allocSpec.loadFile(MVX_ALLOC_SPEC, error)) {
+            report_fatal_error(Twine(error));
+        }
+    }
+    if (!MVX_CHECKPOINT.empty()) {
+        setupCheckpoint(M);
+    } else if (MVX_RESUME) {
+        report_fatal_error("-mvx-resume needs -mvx-checkpoint");
+    }
+    // Wrapper calls only look like allocations to SVF, and library calls
+    // taking callbacks like their models, until restored below
+    m_allocSpec.redirectForSolve(M);
+    m_libcModels.redirectForSolve(M);
+
     // Create SVF and run on module
     SVF::SVFModule *svfModule = SVF::LLVMModuleSet::getLLVMModuleSet()->buildSVFModule(M);
-    m_pwpa = std::make_unique<SVF::WPAPass>();
-    m_pwpa->runOnModule(svfModule);
+    // Over budget, it's not even worth starting the solve
+    bool overBudget = overMemoryBudget();
+    if (overBudget || !solve(svfModule)) {
+        m_allocSpec.restoreAfterSolve();
+        m_libcModels.restoreAfterSolve();
+        SVF::LLVMModuleSet::releaseLLVMModuleSet();
+        m_libcModels.release();
+        m_allocSpec.release();
+        startSummarizing(overBudget ? MEM_BUDGET_REASON : DEADLINE_REASON);
+    } else {
+        m_allocSpec.restoreAfterSolve();
+        m_libcModels.restoreAfterSolve();
+        std::string error;
+        if (m_pcheckpoint && !m_resumedSolve &&
+            !m_pcheckpoint->commitPointsTo(error)) {
+            errs() << "MVXAA: " << error << "\n";
+        }
+        if (overMemoryBudget()) {
+            releaseSolverState();
+            startSummarizing(MEM_BUDGET_REASON);
+        } else if (pastDeadline(m_solveDeadline)) {
+            releaseSolverState();
+            startSummarizing(DEADLINE_REASON);
+        }
+    }
     // Andersen *ander = AndersenWaveDiff::createAndersenWaveDiff(svfModule);
 
-    // Iterate through callgraph of function we're interested in
-    CallGraph *CG = new CallGraph(M);
+    if (MVX_DISPATCH_TABLES) {
+        // Without the solve, any write through a pointer may hit a table
+        m_pdispatchTables = std::make_unique<DispatchTables>(
+            M, [this](Value *ptr, Value *G) {
+                return !m_pwpa || m_pwpa->alias(ptr, G);
+            });
+    }
+
+    m_pids = std::make_unique<StableValueIds>(M);
+    if (MVX_HEAP) {
+        m_pheapSites = std::make_unique<HeapSites>(M, m_allocSpec);
+    }
+}
+
+/**
+ * @brief Find the relocation set of the region guarded by guardedFunc, from
+ * the walk or from summaries. Results add up to those of earlier calls,
+ * unless resetWalk is called in between.
+ *
+ * @param guardedFunc
+ */
+void MVXAA::analyzeGuarded(Function *guardedFunc) {
+    m_pguardedFunc = guardedFunc;
+    if (MVX_SUMMARIES || !MVX_SUMMARY_ENTRIES.empty()) {
+        answerFromSummaries(guardedFunc);
+    } else {
+        // Iterate through callgraph of function we're interested in
+        CallGraph CG(*m_pmainmodule);
 
-    if (Function *guardedFunc = M.getFunction(m_mvxFunc)) {
-        CallGraphNode *guardedHead = CG->getOrInsertFunction(guardedFunc);
-        for (auto IT = df_begin(guardedHead), end = df_end(guardedHead);
-             IT != end; ++IT) {
-            if (Function *F = IT->getFunction()) {
-                this->visit(F);
+        if (walkCheckpointed() && MVX_RESUME) {
+            resumeWalk();
+        }
+        walkCallGraph(CG, guardedFunc, "");
+        // Callbacks handed to library calls, and functions called through
+        // constant tables, run as part of the guarded region too, but the
+        // call graph has no edge to them
+        bool queuedAddressTaken = false;
+        while (!m_pendingCallbacks.empty() ||
+               (m_summarizing && !queuedAddressTaken)) {
+            if (m_pendingCallbacks.empty()) {
+                // Without the solve, any indirect call of the region may
+                // reach any function whose address is taken
+                queueAddressTakenFunctions(guardedFunc);
+                queuedAddressTaken = true;
+                continue;
             }
+            std::pair<Function *, Function *> callback =
+                m_pendingCallbacks.back();
+            m_pendingCallbacks.pop_back();
+            m_startedCallbacks.push_back(callback);
+            walkCallGraph(CG, callback.first,
+                          m_callPaths[callback.second] + " > ",
+                          m_callDepths[callback.second] + 1);
+        }
+
+        // If load instructions's pointer are GEP, resolve their loaders, this
+        // is for the case of pointers to pointers in structs
+        resolveGEPParents(m_targetGEPSet);
+
+        // For direct globals, just assume 0 offset:
+        for (Value *TG : m_targetGlobals) {
+            logEvent(EventLog::TargetGlobal, TG);
+            m_pglobalsAndOffsets->insert(TG, 0, getOrigin(TG));
         }
-    } else {
-        llvm_unreachable("Guarded function name doesn't match any functions");
     }
+}
 
-    // If load instructions's pointer are GEP, resolve their loaders, this is
-    // for the case of pointers to pointers in structs
-    resolveGEPParents(m_targetGEPSet);
+/**
+ * @brief Forget the results and walk state of the last analyzeGuarded, the
+ * solve is kept
+ */
+void MVXAA::resetWalk() {
+    m_fpointers.clear();
+    m_targetGlobals.clear();
+    m_targetGEPSet.clear();
+    m_visitedNodes.clear();
+    m_pendingCallbacks.clear();
+    m_pcurrentFunc = nullptr;
+    m_targetOrigins.clear();
+    m_callPaths.clear();
+    m_callDepths.clear();
+    m_pruned.clear();
+    m_walkedFuncs.clear();
+    m_startedCallbacks.clear();
+    m_resumedFuncs.clear();
+    m_addedEscaped = false;
+    // Each region gets the whole deadline, the solve is already done
+    m_walkDeadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(MVX_DEADLINE);
+    m_pglobalsAndOffsets = std::make_unique<RelocationSet>(*m_pmainmodule);
+    if (m_pheapSites) {
+        m_pheapSites = std::make_unique<HeapSites>(*m_pmainmodule, m_allocSpec);
+    }
+    m_summarizedFuncs = 0;
+    if (m_pwpa) {
+        // Only the last region's walk ran out of time, the next one starts
+        // precise again
+        m_summarizing = false;
+        m_degradedReason = nullptr;
+    } else if (m_summarizing) {
+        // Without the solve, what any summarized function may reach holds
+        // for every region
+        startSummarizing(m_degradedReason);
+    }
+}
+
+/**
+ * @brief Summarize every function once, bottom-up, and answer the guarded
+ * function with a lookup instead of a walk
+ *
+ * @param guardedFunc
+ */
+void MVXAA::answerFromSummaries(Function *guardedFunc) {
+    if (m_pheapSites) {
+        report_fatal_error("-mvx-heap needs the guarded function walk, it "
+                           "can't be used with -mvx-summaries");
+    }
+    ModRefSummaries summaries(*m_pmainmodule);
+    buildSummaries(summaries);
+
+    if (const ModRefSummaries::Summary *S = summaries.lookup(guardedFunc)) {
+        addSummary(*S, *m_pglobalsAndOffsets);
+        for (const CallInst *CI : S->indirectCalls) {
+            m_fpointers.insert(const_cast<CallInst *>(CI));
+        }
+    }
+    if (!MVX_SUMMARY_ENTRIES.empty()) {
+        dumpSummariesToFile(summaries);
+    }
+}
 
-    LLVM_DEBUG(dbgs() << "Target Globals to Move:\n");
-    // For direct globals, just assume 0 offset:
+/**
+ * @brief Summarize every function, bottom-up
+ *
+ * @param summaries
+ */
+void MVXAA::buildSummaries(ModRefSummaries &summaries) {
+    if (m_summarizing) {
+        report_fatal_error("Can't build summaries, the solve exceeded "
+                           "-mvx-mem-budget");
+    }
+    collectLocalSummaries(summaries);
+    summaries.propagate(MVX_SUMMARY_THREADS);
+}
+
+/**
+ * @brief Cost of guarding each defined function, or those matching
+ * -mvx-explore-filter, from their summaries: globals and records relocated,
+ * bytes of those globals and indirect calls reached. Written to
+ * -mvx-explore-dump, most expensive first.
+ */
+void MVXAA::exploreEntryPoints() {
+    Regex filter(MVX_EXPLORE_FILTER);
+    std::string error;
+    if (!filter.isValid(error)) {
+        report_fatal_error(Twine("Bad -mvx-explore-filter: ") + error);
+    }
+    ModRefSummaries summaries(*m_pmainmodule);
+    buildSummaries(summaries);
+
+    struct EntryCost {
+        Function *F;
+        unsigned globals;
+        unsigned records;
+        uint64_t bytes;
+        unsigned indirectCalls;
+    };
+    std::vector<EntryCost> costs;
+    const DataLayout &DL = m_pmainmodule->getDataLayout();
+    for (Function &F : *m_pmainmodule) {
+        if (F.isDeclaration() ||
+            (!MVX_EXPLORE_FILTER.empty() && !filter.match(F.getName()))) {
+            continue;
+        }
+        const ModRefSummaries::Summary *S = summaries.lookup(&F);
+        if (!S) {
+            continue;
+        }
+        EntryCost cost = {&F, 0, (unsigned)S->records.size(), 0,
+                          (unsigned)S->indirectCalls.size()};
+        // Records are sorted by global, count each global once
+        const GlobalVariable *previous = nullptr;
+        for (const RelocationSet::Record_t &R : S->records) {
+            const GlobalVariable *G = m_pglobalsAndOffsets->getGlobal(R);
+            if (G != previous) {
+                ++cost.globals;
+                cost.bytes += DL.getTypeAllocSize(G->getValueType());
+                previous = G;
+            }
+        }
+        costs.push_back(cost);
+    }
+    std::sort(costs.begin(), costs.end(),
+              [](const EntryCost &A, const EntryCost &B) {
+                  if (A.bytes != B.bytes) {
+                      return A.bytes > B.bytes;
+                  }
+                  if (A.globals != B.globals) {
+                      return A.globals > B.globals;
+                  }
+                  if (A.indirectCalls != B.indirectCalls) {
+                      return A.indirectCalls > B.indirectCalls;
+                  }
+                  return A.F->getName() < B.F->getName();
+              });
+
+    std::error_code E;
+    raw_fd_ostream exploreFile(MVX_EXPLORE_DUMP, E);
+    if (E) {
+        report_fatal_error(Twine("Error opening explore dump file ") +
+                           MVX_EXPLORE_DUMP + ": " + E.message());
+    }
+    exploreFile << "# entry,globals,records,bytes,indirect_calls\n";
+    for (const EntryCost &cost : costs) {
+        exploreFile << cost.F->getName() << "," << cost.globals << ","
+                    << cost.records << "," << cost.bytes << ","
+                    << cost.indirectCalls << "\n";
+    }
+}
+
+/**
+ * @brief Visit every defined function on its own and keep what it finds as
+ * its local facts. Calls the call graph has no edge for, to callbacks and
+ * through constant tables, become summary edges.
+ *
+ * @param summaries
+ */
+void MVXAA::collectLocalSummaries(ModRefSummaries &summaries) {
+    // The visitor reports into the walk's state, give it a scratch set
+    std::unique_ptr<RelocationSet> result = std::move(m_pglobalsAndOffsets);
+    m_pglobalsAndOffsets = std::make_unique<RelocationSet>(*m_pmainmodule);
+    m_collectingSummaries = true;
+    for (Function &F : *m_pmainmodule) {
+        if (F.isDeclaration()) {
+            continue;
+        }
+        m_pcurrentFunc = &F;
+        this->visit(F);
+        resolveGEPParents(m_targetGEPSet);
+        for (Value *TG : m_targetGlobals) {
+            m_pglobalsAndOffsets->insert(TG, 0);
+        }
+
+        ModRefSummaries::Summary &S = summaries.getLocal(&F);
+        S.records.insert(m_pglobalsAndOffsets->begin(),
+                         m_pglobalsAndOffsets->end());
+        S.ranges = m_pglobalsAndOffsets->ranges();
+        S.accesses = m_pglobalsAndOffsets->accesses();
+        for (const std::pair<Function *, Function *> &callee :
+             m_pendingCallbacks) {
+            summaries.addCallee(&F, callee.first);
+        }
+        S.indirectCalls.insert(m_fpointers.begin(), m_fpointers.end());
+
+        m_pglobalsAndOffsets->clear();
+        m_targetGlobals.clear();
+        m_targetGEPSet.clear();
+        m_pendingCallbacks.clear();
+        m_fpointers.clear();
+    }
+    m_collectingSummaries = false;
+    m_pglobalsAndOffsets = std::move(result);
+}
+
+/**
+ * @brief Add a summary's records and accesses to a relocation set
+ *
+ * @param S
+ * @param relocations
+ */
+void MVXAA::addSummary(const ModRefSummaries::Summary &S,
+                       RelocationSet &relocations) {
+    for (const RelocationSet::Record_t &R : S.records) {
+        relocations.insert(relocations.getGlobal(R), R.second);
+    }
+    for (const RelocationSet::Range_t &R : S.ranges) {
+        relocations.insertRange(relocations.getGlobal(R.global), R.start,
+                                R.stride, R.count, R.fieldOffset);
+    }
+    for (const auto &access : S.accesses) {
+        relocations.markAccess(relocations.getGlobal(access.first),
+                               access.first.second, access.second);
+    }
+}
+
+/**
+ * @brief Write the records of each -mvx-summary-entries function as
+ * "entry,name,offset,access" lines
+ *
+ * @param summaries
+ */
+void MVXAA::dumpSummariesToFile(const ModRefSummaries &summaries) {
+    std::error_code E;
+    raw_fd_ostream summaryFile(MVX_SUMMARY_DUMP, E);
+    if (E) {
+        report_fatal_error(Twine("Error opening summary dump file ") +
+                           MVX_SUMMARY_DUMP + ": " + E.message());
+    }
+    for (const std::string &entry : MVX_SUMMARY_ENTRIES) {
+        Function *F = m_pmainmodule->getFunction(entry);
+        const ModRefSummaries::Summary *S =
+            F ? summaries.lookup(F) : nullptr;
+        if (!S) {
+            errs() << "MVXAA: no summary for entry " << entry << "\n";
+            continue;
+        }
+        RelocationSet relocations(*m_pmainmodule);
+        addSummary(*S, relocations);
+        for (const RelocationSet::Record_t &R : relocations) {
+            summaryFile << entry << "," << relocations.getGlobal(R)->getName()
+                        << "," << R.second << ","
+                        << RelocationSet::accessName(relocations.getAccess(R))
+                        << "\n";
+        }
+    }
+}
+
+/**
+ * @brief Depth-first walk of the call graph from root, visiting every function
+ * not visited by an earlier walk, within the limits of -mvx-policy
+ *
+ * @param CG
+ * @param root
+ * @param pathPrefix Call path leading to root, for reporting
+ * @param baseDepth Call depth of root
+ */
+void MVXAA::walkCallGraph(CallGraph &CG, Function *root, StringRef pathPrefix,
+                          unsigned baseDepth) {
+    CallGraphNode *head = CG.getOrInsertFunction(root);
+    // Depth of the function whose callees are all summarized by the policy,
+    // while the walk is below it
+    unsigned summarizedRoot = TraversalPolicy::NO_LIMIT;
+    auto IT = df_ext_begin(head, m_visitedNodes),
+         end = df_ext_end(head, m_visitedNodes);
+    while (IT != end) {
+        Function *F = IT->getFunction();
+        if (!F) {
+            ++IT;
+            continue;
+        }
+        std::string path = pathPrefix.str();
+        for (unsigned i = 0; i < IT.getPathLength(); ++i) {
+            if (Function *pathFunc = IT.getPath(i)->getFunction()) {
+                path += (i ? " > " : "") + pathFunc->getName().str();
+            }
+        }
+        unsigned depth = baseDepth + IT.getPathLength() - 1;
+        if (summarizedRoot != TraversalPolicy::NO_LIMIT &&
+            depth <= summarizedRoot) {
+            summarizedRoot = TraversalPolicy::NO_LIMIT;
+        }
+        TraversalPolicy::Action action =
+            summarizedRoot == TraversalPolicy::NO_LIMIT
+                ? m_policy.decide(*F, depth)
+                : TraversalPolicy::SUMMARIZE;
+        if (action != TraversalPolicy::VISIT &&
+            summarizedRoot == TraversalPolicy::NO_LIMIT) {
+            m_pruned.insert(std::make_pair(
+                F->getName().str(), std::make_pair(action, path)));
+        }
+        if (action == TraversalPolicy::OPAQUE ||
+            action == TraversalPolicy::TOO_DEEP) {
+            if (action == TraversalPolicy::TOO_DEEP) {
+                // May still be reached by a shorter path
+                m_visitedNodes.erase(*IT);
+            }
+            IT.skipChildren();
+            continue;
+        }
+
+        m_callPaths[F] = path;
+        m_callDepths[F] = depth;
+        m_pcurrentFunc = F;
+        if (action == TraversalPolicy::SUMMARIZE &&
+            summarizedRoot == TraversalPolicy::NO_LIMIT) {
+            summarizedRoot = depth;
+        }
+        if (m_resumedFuncs.count(F)) {
+            // Walked before the checkpoint, its records were restored
+            ++IT;
+            continue;
+        }
+        m_walkedFuncs.push_back(F);
+        if (m_summarizing || action != TraversalPolicy::VISIT) {
+            addEscapedGlobals();
+            summarizeFunction(*F);
+            ++IT;
+            continue;
+        }
+        logEvent(EventLog::VisitFunction, F);
+        this->visit(F);
+        bool overBudget = overMemoryBudget();
+        if (overBudget || pastDeadline(m_walkDeadline)) {
+            // Keep what was found precisely so far. Only memory calls for
+            // dropping SVF, the solve stays usable for later regions
+            // after a deadline
+            resolveGEPParents(m_targetGEPSet);
+            m_targetGEPSet.clear();
+            if (overBudget) {
+                releaseSolverState();
+            }
+            startSummarizing(overBudget ? MEM_BUDGET_REASON : DEADLINE_REASON);
+        } else if (walkCheckpointed() &&
+                   std::chrono::steady_clock::now() - m_lastCheckpoint >
+                       std::chrono::seconds(MVX_CHECKPOINT_INTERVAL)) {
+            saveCheckpoint();
+        }
+        ++IT;
+    }
+}
+
+/**
+ * @brief Set one of SVF's own command line options
+ *
+ * @param name
+ * @param value
+ *
+ * @return false if this SVF build doesn't have it
+ */
+static bool setSVFOption(StringRef name, StringRef value) {
+    StringMap<cl::Option *> &options = cl::getRegisteredOptions();
+    auto it = options.find(name);
+    if (it == options.end()) {
+        return false;
+    }
+    // Not counted as an occurrence, so it can be set again
+    it->second->addOccurrence(0, name, value, true);
+    return true;
+}
+
+/**
+ * @brief Point SVF at the checkpointed points-to sets when resuming and they
+ * exist, or have it write them once solved otherwise. SVF reads and writes
+ * them itself, through its -read-ander and -write-ander options.
+ *
+ * @param M
+ */
+void MVXAA::setupCheckpoint(Module &M) {
+    m_pcheckpoint = std::make_unique<WalkCheckpoint>(
+        MVX_CHECKPOINT, WalkCheckpoint::hashModule(M), m_mvxFunc);
+    m_lastCheckpoint = std::chrono::steady_clock::now();
+    if (std::error_code E = sys::fs::create_directories(MVX_CHECKPOINT)) {
+        report_fatal_error(Twine("Can't create checkpoint directory ") +
+                           MVX_CHECKPOINT + ": " + E.message());
+    }
+
+    std::string pointsTo = m_pcheckpoint->pointsToPath();
+    m_resumedSolve = MVX_RESUME && sys::fs::exists(pointsTo);
+    if (MVX_RESUME && !m_resumedSolve) {
+        errs() << "MVXAA: no points-to sets for this module in "
+               << MVX_CHECKPOINT << ", solving\n";
+    }
+    if (!m_resumedSolve) {
+        // SVF has no way to save or resume a solve halfway
+        errs() << "MVXAA: the solve is only checkpointed once it finishes\n";
+    }
+    // A fresh solve is written out by solve()
+    StringRef name = m_resumedSolve ? "read-ander" : "write-ander";
+    if (!setSVFOption(name, m_resumedSolve ? pointsTo : "")) {
+        report_fatal_error(Twine("This SVF build has no -") + name +
+                           ", the solve can't be checkpointed");
+    }
+}
+
+/**
+ * @brief Are walk checkpoints taken? Only when walking -mvx-func, which the
+ * checkpoint is for, and heap sites aren't part of them.
+ */
+bool MVXAA::walkCheckpointed() const {
+    return m_pcheckpoint && !m_pheapSites && m_pguardedFunc &&
+           m_pguardedFunc->getName() == m_mvxFunc;
+}
+
+/**
+ * @brief Save the walk so far. Pointers waiting on resolveGEPParents are
+ * resolved now, as for the memory budget, and the direct globals recorded.
+ */
+void MVXAA::saveCheckpoint() {
+    resolveGEPParents(m_targetGEPSet);
+    m_targetGEPSet.clear();
     for (Value *TG : m_targetGlobals) {
-        LLVM_DEBUG(dbgs() << *TG << "\n");
-        m_globalsAndOffsets.insert(GlobalPair_t(TG->getName(), 0));
+        m_pglobalsAndOffsets->insert(TG, 0, getOrigin(TG));
     }
 
-    // Now dump the data to file:
-    dumpGlobalsToFile(m_globalsAndOffsets);
+    WalkCheckpoint::State S;
+    S.visited = m_walkedFuncs;
+    S.callbacks = m_startedCallbacks;
+    S.callbacks.insert(S.callbacks.end(), m_pendingCallbacks.begin(),
+                       m_pendingCallbacks.end());
+    S.calls.assign(m_fpointers.begin(), m_fpointers.end());
+    std::string error;
+    if (!m_pcheckpoint->save(*m_pmainmodule, *m_pglobalsAndOffsets, S,
+                             error)) {
+        errs() << "MVXAA: " << error << "\n";
+    }
+    m_lastCheckpoint = std::chrono::steady_clock::now();
+}
 
-    return false;
+/**
+ * @brief Restore the records and indirect calls of the last walk checkpoint,
+ * the walk then skips the functions it had walked and picks up the callbacks
+ * it had queued
+ */
+void MVXAA::resumeWalk() {
+    WalkCheckpoint::State S;
+    std::string error;
+    if (!m_pcheckpoint->load(*m_pmainmodule, *m_pglobalsAndOffsets, S,
+                             error)) {
+        errs() << "MVXAA: " << error << ", walking from the start\n";
+        return;
+    }
+    m_walkedFuncs = S.visited;
+    m_resumedFuncs.insert(S.visited.begin(), S.visited.end());
+    m_pendingCallbacks.insert(m_pendingCallbacks.end(), S.callbacks.begin(),
+                              S.callbacks.end());
+    m_fpointers.insert(S.calls.begin(), S.calls.end());
+    errs() << "MVXAA: resumed, " << S.visited.size()
+           << " functions already walked\n";
+}
+
+/**
+ * @brief Write what -mvx-policy kept the walk from visiting, as
+ * "function,action,call path" lines
+ */
+void MVXAA::dumpPolicyReport() {
+    std::error_code E;
+    raw_fd_ostream reportFile(MVX_POLICY_REPORT, E);
+    if (E) {
+        report_fatal_error(Twine("Error opening policy report file ") +
+                           MVX_POLICY_REPORT + ": " + E.message());
+    }
+    for (const auto &pruned : m_pruned) {
+        reportFile << pruned.first << ","
+                   << TraversalPolicy::actionName(pruned.second.first) << ","
+                   << pruned.second.second << "\n";
+    }
+    errs() << "MVXAA: policy pruned " << m_pruned.size()
+           << " functions, see " << MVX_POLICY_REPORT << "\n";
 }
 
 /**
@@ -73,25 +936,29 @@ bool MVXAA::runOnModule(Module &M) {
  * @param I
  */
 void MVXAA::visitLoadInst(LoadInst &I) {
-    LLVM_DEBUG(dbgs() << "LOAD:" << I << "\n");
+    logEvent(EventLog::VisitLoad, &I);
     // If we are loading from something that aliases a global
     Value *pointerOperand = I.getPointerOperand();
-    if (Value *loadedFromAlias = aliasesGlobal(pointerOperand)) {
+    if (m_collectingSummaries) {
+        markAccess(pointerOperand, RelocationSet::READ_ONLY);
+    }
+    if (Value *loadedFromAlias =
+            queryGlobalAlias(QueryTrace::LoadPtr, pointerOperand)) {
         // If our value that's loaded into is a pointer type, and it aliases
         // to a global:
         Value *loadVal = dyn_cast<Value>(&I);
         assert(loadVal && "Load instruction should be value");
         if (loadVal->getType()->isPointerTy()) {
-            if (Value *aliasedGlobal = aliasesGlobal(loadVal)) {
-                LLVM_DEBUG(dbgs() << "LOAD Alias:\n"
-                                  << std::string(30, '*') << "\n"
-                                  << *loadVal << "\naliases\n"
-                                  << *aliasedGlobal << "\n"
-                                  << std::string(30, '*') << "\n");
+            if (Value *aliasedGlobal =
+                    queryGlobalAlias(QueryTrace::LoadVal, loadVal)) {
+                logEvent(EventLog::LoadAlias, loadVal, aliasedGlobal);
                 processPointerOperand(pointerOperand);
             }
         }
     }
+    if (m_pheapSites && I.getType()->isPointerTy()) {
+        processHeapPointerOperand(pointerOperand);
+    }
 }
 
 /**
@@ -102,37 +969,619 @@ void MVXAA::visitLoadInst(LoadInst &I) {
  * @param I
  */
 void MVXAA::visitCallInst(CallInst &I) {
-    LLVM_DEBUG(dbgs() << "CALL: " << I << "\n");
+    logEvent(EventLog::VisitCall, &I);
     if (I.getCalledFunction() == nullptr) {
         m_fpointers.insert(&I);
 
+        // Calls through never-written table slots go to the functions in
+        // the initializers, without asking the points-to sets. The load of
+        // the slot is still recorded like any other.
+        SmallSetVector<Function *, 8> tableTargets;
+        if (m_pdispatchTables &&
+            m_pdispatchTables->resolveCallees(I.getCalledOperand(),
+                                              tableTargets)) {
+            for (Function *target : tableTargets) {
+                if (!target->isDeclaration()) {
+                    m_pendingCallbacks.push_back(
+                        std::make_pair(target, m_pcurrentFunc));
+                }
+            }
+            return;
+        }
+
+        // The callee isn't walked, whatever it's handed escapes the region
+        markPointerArgs(I, RelocationSet::ESCAPED);
+
         LoadInst *loadInst = dyn_cast_or_null<LoadInst>(I.getCalledOperand());
         // assert(loadInst && "Indirect call's operand should be a load inst!");
         if (loadInst != nullptr) {
 
             // If the load instruction's pointer operand aliases any globals
-            if (Value *aliasedGlobal =
-                    aliasesGlobal(loadInst->getPointerOperand())) {
+            if (Value *aliasedGlobal = queryGlobalAlias(
+                    QueryTrace::CallPtr, loadInst->getPointerOperand())) {
                 processPointerOperand(loadInst->getPointerOperand());
             }
         }
+    } else if (const LibcSummary *S =
+                   lookupLibcSummary(I.getCalledFunction()->getName())) {
+        applyLibcSummary(I, *S);
+    } else if (I.getCalledFunction()->isDeclaration() &&
+               !I.getCalledFunction()->isIntrinsic() &&
+               !I.getCalledFunction()->onlyReadsMemory()) {
+        markPointerArgs(I, RelocationSet::ESCAPED);
+    } else if (!I.getCalledFunction()->isDeclaration()) {
+        Function *callee = I.getCalledFunction();
+        auto depthIt = m_callDepths.find(m_pcurrentFunc);
+        unsigned depth =
+            depthIt == m_callDepths.end() ? 0 : depthIt->second + 1;
+        TraversalPolicy::Action action = m_policy.decide(*callee, depth);
+        if (action == TraversalPolicy::OPAQUE ||
+            action == TraversalPolicy::TOO_DEEP) {
+            markPrunedCall(I, *callee);
+        }
+    }
+}
+
+/**
+ * @brief Stores and atomics in the guarded region write the globals their
+ * pointer may alias
+ *
+ * @param I
+ */
+void MVXAA::visitStoreInst(StoreInst &I) {
+    markAccess(I.getPointerOperand(), RelocationSet::WRITTEN);
+}
+
+void MVXAA::visitAtomicRMWInst(AtomicRMWInst &I) {
+    markAccess(I.getPointerOperand(), RelocationSet::WRITTEN);
+}
+
+void MVXAA::visitAtomicCmpXchgInst(AtomicCmpXchgInst &I) {
+    markAccess(I.getPointerOperand(), RelocationSet::WRITTEN);
+}
+
+/**
+ * @brief Mark the globals ptr may point into as accessed. The byte offset is
+ * only used when ptr is based on the global itself, a pointer that merely
+ * aliases a global may point anywhere in it.
+ *
+ * @param ptr
+ * @param A
+ * @param wholeObject Mark the whole global even for an exact offset
+ */
+void MVXAA::markAccess(Value *ptr, RelocationSet::Access A,
+                       bool wholeObject) {
+    SmallVector<PointerBase, 4> bases;
+    decomposePointer(ptr, m_pmainmodule->getDataLayout(), bases);
+    for (const PointerBase &B : bases) {
+        if (m_pglobals->count(B.base)) {
+            m_pglobalsAndOffsets->markAccess(
+                B.base,
+                B.isConstant() && !wholeObject ? B.offset
+                                        : RelocationSet::WHOLE_OBJECT,
+                A);
+            continue;
+        }
+        if (isa<AllocaInst>(B.base) || isa<Function>(B.base) ||
+            isa<Constant>(B.base)) {
+            continue;
+        }
+        // Unlike aliasesGlobal, every global it may alias counts
+        for (Value *GV : *m_pglobals) {
+            if (!cast<GlobalVariable>(GV)->isConstant() &&
+                m_pwpa->alias(B.base, GV)) {
+                m_pglobalsAndOffsets->markAccess(
+                    GV, RelocationSet::WHOLE_OBJECT, A);
+            }
+        }
     }
 }
 
 /**
- * @brief Helper method, common to visitCallInst and visitLoadInst
+ * @brief markAccess for every pointer argument of a call
+ *
+ * @param I
+ * @param A
+ */
+void MVXAA::markPointerArgs(CallInst &I, RelocationSet::Access A) {
+    for (Value *arg : I.args()) {
+        if (arg->getType()->isPointerTy()) {
+            markAccess(arg, A);
+        }
+    }
+}
+
+/**
+ * @brief The walk skips callee, as -mvx-policy made it opaque or too deep.
+ * What it is handed escapes the region, and the globals it names may be
+ * written. Those aren't relocated for it, the policy said not to look.
+ *
+ * @param I
+ * @param callee
+ */
+void MVXAA::markPrunedCall(CallInst &I, Function &callee) {
+    markPointerArgs(I, RelocationSet::ESCAPED);
+    SetVector<Value *> referenced;
+    conservative::collectReferencedGlobals(callee, *m_pglobals, referenced);
+    for (Value *G : referenced) {
+        m_pglobalsAndOffsets->markAccess(G, RelocationSet::WHOLE_OBJECT,
+                                         RelocationSet::WRITTEN);
+    }
+}
+
+/**
+ * @brief Library calls aren't visited, apply their summarized pointer
+ * effects instead: memory they copy from or into counts like a pointer load
+ * if it aliases a global, and callbacks they invoke are walked as well
+ *
+ * @param I
+ * @param S
+ */
+void MVXAA::applyLibcSummary(CallInst &I, const LibcSummary &S) {
+    for (int arg : {S.readArg, S.writeArg}) {
+        if (arg < 0 || (unsigned)arg >= I.arg_size()) {
+            continue;
+        }
+        Value *ptr = I.getArgOperand(arg)->stripPointerCasts();
+        if (queryGlobalAlias(QueryTrace::CallArg, ptr)) {
+            processPointerOperand(ptr);
+        }
+    }
+    if (S.writeArg >= 0 && (unsigned)S.writeArg < I.arg_size()) {
+        // Copies and fills may cover more than the field pointed to
+        markAccess(I.getArgOperand(S.writeArg), RelocationSet::WRITTEN, true);
+    }
+    if (S.callbackArg >= 0 && (unsigned)S.callbackArg < I.arg_size()) {
+        Function *callback = dyn_cast<Function>(
+            I.getArgOperand(S.callbackArg)->stripPointerCasts());
+        if (callback && !callback->isDeclaration()) {
+            m_pendingCallbacks.push_back(
+                std::make_pair(callback, m_pcurrentFunc));
+        }
+    }
+}
+
+/**
+ * @brief Helper method, common to visitCallInst and visitLoadInst. Pointers
+ * other than the globals themselves are decomposed into a base and byte
+ * offset by resolveGEPParents once the walk is done.
  *
  * @param ptrOperand
  */
 void MVXAA::processPointerOperand(Value *ptrOperand) {
-    if (m_pglobals->find(ptrOperand) != m_pglobals->end()) {
+    if (m_pglobals->count(ptrOperand)) {
         m_targetGlobals.insert(ptrOperand);
-    } else if (isa<GetElementPtrInst>(ptrOperand)) {
-        m_targetGEPSet.insert(ptrOperand);
     } else {
-        errs() << "LOAD: There is a with ptroperand and loadval "
-                  "both aliasing globals, but the ptroperand is "
-                  "not a GEP instruction.\n";
+        m_targetGEPSet.insert(ptrOperand);
+    }
+    m_targetOrigins.insert(std::make_pair(ptrOperand, m_pcurrentFunc));
+}
+
+/**
+ * @brief Call path from the guarded function to the function where a target
+ * global or GEP was found
+ *
+ * @param target
+ *
+ * @return Empty if the target wasn't found by the walk
+ */
+StringRef MVXAA::getOrigin(Value *target) const {
+    auto it = m_targetOrigins.find(target);
+    if (it == m_targetOrigins.end()) {
+        return StringRef();
+    }
+    auto pathIt = m_callPaths.find(it->second);
+    return pathIt == m_callPaths.end() ? StringRef()
+                                       : StringRef(pathIt->second);
+}
+
+/**
+ * @brief Heap counterpart of aliasesGlobal, a pointer may reach objects of
+ * several allocation sites so all of them are returned
+ *
+ * @param V Value to check against all known allocation sites
+ * @param sites Set to the allocating calls V may alias
+ */
+void MVXAA::aliasesHeapSites(Value *V,
+                             SmallVectorImpl<CallBase *> &sites) const {
+    assert(m_pwpa && "WPA pointer not initialized!");
+    sites.clear();
+    for (CallBase *site : m_pheapSites->getSites()) {
+        if (m_pwpa->alias(V, site)) {
+            sites.push_back(site);
+        }
+    }
+}
+
+/**
+ * @brief A pointer is loaded from ptrOperand, if that points into a heap
+ * object record the object's allocation site and the field offset, the same
+ * way resolveGEPParents does for globals
+ *
+ * @param ptrOperand
+ */
+void MVXAA::processHeapPointerOperand(Value *ptrOperand) {
+    SmallVector<PointerBase, 4> bases;
+    decomposePointer(ptrOperand, m_pmainmodule->getDataLayout(), bases);
+    SmallVector<CallBase *, 4> sites;
+    for (const PointerBase &B : bases) {
+        if (!B.isConstant()) {
+            logEvent(EventLog::NotConstant, ptrOperand);
+            continue;
+        }
+        aliasesHeapSites(B.base, sites);
+        for (CallBase *site : sites) {
+            logEvent(EventLog::HeapParent, site, nullptr, B.offset);
+            m_pheapSites->insert(site, B.offset);
+        }
+    }
+}
+
+/**
+ * @brief Write the graph of globals reachable through the relocated globals'
+ * pointer slots to -mvx-graph. Once the solve is released only initializers
+ * and constant stores give edges.
+ */
+void MVXAA::exportGlobalGraph() {
+    SetVector<Value *> targets;
+    for (Value *GV : *m_pglobals) {
+        if (!cast<GlobalVariable>(GV)->isConstant()) {
+            targets.insert(GV);
+        }
+    }
+    if (!m_pwpa) {
+        errs() << "MVXAA: no points-to sets left for -mvx-graph, only "
+                  "constant pointers are exported\n";
+    }
+    GlobalGraph graph(*m_pmainmodule, *m_pglobalsAndOffsets, targets,
+                      [this](Value *ptr, Value *G) {
+                          return m_pwpa && m_pwpa->alias(ptr, G);
+                      });
+
+    std::error_code E;
+    raw_fd_ostream graphFile(MVX_GRAPH, E, sys::fs::OF_None);
+    if (E) {
+        report_fatal_error(Twine("Error opening graph file ") + MVX_GRAPH +
+                           ": " + E.message());
+    }
+    graph.writeBinary(graphFile);
+    LLVM_DEBUG(dbgs() << "Global graph: " << graph.numEdges() << " edges\n");
+}
+
+/**
+ * @brief Targets of the guarded region's indirect calls. Calls through
+ * constant dispatch tables get the functions of the table, the others
+ * whatever the callee pointer may alias.
+ */
+std::unique_ptr<IndirectCallTargets> MVXAA::collectCallTargets() {
+    if (!m_pwpa) {
+        errs() << "MVXAA: no points-to sets left for indirect calls, every "
+                  "address-taken function of the right arity is a target\n";
+    }
+    auto callTargets = std::make_unique<IndirectCallTargets>(
+        *m_pmainmodule, *m_pids, [this](Value *callee, Function *F) {
+            return !m_pwpa || m_pwpa->alias(callee, F);
+        });
+    for (CallInst *CI : m_fpointers) {
+        SmallSetVector<Function *, 8> tableTargets;
+        if (m_pdispatchTables &&
+            m_pdispatchTables->resolveCallees(CI->getCalledOperand(),
+                                              tableTargets)) {
+            callTargets->addSite(CI, tableTargets.getArrayRef());
+        } else {
+            callTargets->addSite(CI);
+        }
+    }
+    LLVM_DEBUG(dbgs() << "Call targets: " << callTargets->numSites()
+                      << " sites, " << callTargets->numTargets()
+                      << " targets\n");
+    return callTargets;
+}
+
+/**
+ * @brief Write the targets of the guarded region's indirect calls to
+ * -mvx-call-targets
+ *
+ * @param callTargets
+ */
+void MVXAA::exportCallTargets(const IndirectCallTargets &callTargets) {
+    std::error_code E;
+    raw_fd_ostream callsFile(MVX_CALL_TARGETS, E, sys::fs::OF_None);
+    if (E) {
+        report_fatal_error(Twine("Error opening call targets file ") +
+                           MVX_CALL_TARGETS + ": " + E.message());
+    }
+    callTargets.writeBinary(callsFile);
+    if (MVX_METADATA) {
+        callTargets.attachMetadata();
+    }
+}
+
+/**
+ * @brief Turn indirect calls with at most -mvx-promote-calls targets into a
+ * chain of compares against each target with a direct call, falling back to
+ * the original indirect call. Runs once every query is answered, the solve
+ * knows nothing about the new instructions.
+ *
+ * @param callTargets
+ */
+void MVXAA::promoteIndirectCalls(const IndirectCallTargets &callTargets) {
+    unsigned promotedSites = 0;
+    for (const auto &site : callTargets.sites()) {
+        CallInst *CI = site.first;
+        if (site.second.empty() || site.second.size() > MVX_PROMOTE_CALLS) {
+            continue;
+        }
+        bool promoted = false;
+        for (Function *target : site.second) {
+            const char *reason = nullptr;
+            if (!isLegalToPromote(*CI, target, &reason)) {
+                LLVM_DEBUG(dbgs() << "Not promoting " << *CI << " to "
+                                  << target->getName() << ": " << reason
+                                  << "\n");
+                continue;
+            }
+            CallBase &direct = promoteCallWithIfThenElse(*CI, target);
+            // Only the fallback is still an indirect call site
+            direct.setMetadata(IndirectCallTargets::CALLSITE_MD, nullptr);
+            promoted = true;
+        }
+        promotedSites += promoted;
+    }
+    LLVM_DEBUG(dbgs() << "Promoted " << promotedSites << " of "
+                      << callTargets.numSites() << " indirect calls\n");
+}
+
+/**
+ * @brief Write the heap records to -mvx-heap-dump
+ */
+void MVXAA::dumpHeapSitesToFile() {
+    std::error_code E;
+    raw_fd_ostream heapFile(MVX_HEAP_DUMP, E);
+    if (E) {
+        report_fatal_error(Twine("Error opening heap dump file ") +
+                           MVX_HEAP_DUMP + ": " + E.message());
+    }
+    m_pheapSites->write(heapFile, *m_pids);
+}
+
+/**
+ * @brief Write the events recorded to -mvx-event-log
+ */
+void MVXAA::writeEventLog() {
+    std::error_code E;
+    raw_fd_ostream eventFile(MVX_EVENT_LOG, E);
+    if (E) {
+        report_fatal_error(Twine("Error opening event log ") + MVX_EVENT_LOG +
+                           ": " + E.message());
+    }
+    m_pevents->write(eventFile, *m_pids);
+    m_pevents.reset();
+}
+
+/**
+ * @brief Resident set size, from /proc/self/statm. Unlike the malloc usage,
+ * this counts mmapped chunks, which hold SVF's large points-to bitvectors.
+ *
+ * @return Bytes, or the malloc usage where there is no /proc
+ */
+static size_t residentBytes() {
+    FILE *statm = fopen("/proc/self/statm", "r");
+    unsigned long size, resident;
+    bool read = statm && fscanf(statm, "%lu %lu", &size, &resident) == 2;
+    if (statm) {
+        fclose(statm);
+    }
+    if (!read) {
+        return sys::Process::GetMallocUsage();
+    }
+    return (size_t)resident * sys::Process::getPageSizeEstimate();
+}
+
+/**
+ * @brief Is the resident set past -mvx-mem-budget? Always false without a
+ * budget.
+ *
+ * @return
+ */
+bool MVXAA::overMemoryBudget() const {
+    return MVX_MEM_BUDGET && residentBytes() > (size_t)MVX_MEM_BUDGET << 20;
+}
+
+/**
+ * @brief Has -mvx-deadline passed? Always false without a deadline.
+ *
+ * @param deadline m_solveDeadline or m_walkDeadline
+ *
+ * @return
+ */
+bool MVXAA::pastDeadline(
+    std::chrono::steady_clock::time_point deadline) const {
+    return MVX_DEADLINE && std::chrono::steady_clock::now() > deadline;
+}
+
+/**
+ * @brief Run the SVF solve. With -mvx-deadline it runs in a child process,
+ * which writes the points-to sets for us to read back, and is killed if the
+ * deadline passes first. SVF can't be interrupted, and a solve left running
+ * in this process would race us on the module.
+ *
+ * @param svfModule
+ *
+ * @return false if the deadline passed first, m_pwpa is only set otherwise
+ */
+bool MVXAA::solve(SVF::SVFModule *svfModule) {
+    auto wpa = std::make_unique<SVF::WPAPass>();
+    // Where a fresh solve is saved, to resume from
+    std::string checkpointed = m_pcheckpoint && !m_resumedSolve
+                                   ? m_pcheckpoint->pendingPointsToPath()
+                                   : "";
+    if (!MVX_DEADLINE || m_resumedSolve) {
+        setSVFOption("write-ander", checkpointed);
+        wpa->runOnModule(svfModule);
+        m_pwpa = std::move(wpa);
+        return true;
+    }
+
+    SmallString<128> pointsTo(checkpointed);
+    if (pointsTo.empty()) {
+        if (std::error_code E =
+                sys::fs::createTemporaryFile("mvx-solve", "pts", pointsTo)) {
+            report_fatal_error(Twine("Can't create the points-to file: ") +
+                               E.message());
+        }
+    }
+    FileRemover removeTemporary(pointsTo, checkpointed.empty());
+    if (!setSVFOption("write-ander", "")) {
+        report_fatal_error("This SVF build has no -write-ander, the solve "
+                           "can't be run under -mvx-deadline");
+    }
+
+    outs().flush();
+    errs().flush();
+    pid_t child = fork();
+    if (child < 0) {
+        report_fatal_error(Twine("Can't fork the solve: ") +
+                           sys::StrError(errno));
+    }
+    if (child == 0) {
+        setSVFOption("write-ander", pointsTo);
+        wpa->runOnModule(svfModule);
+        outs().flush();
+        errs().flush();
+        _exit(0);
+    }
+
+    int status = 0;
+    for (;;) {
+        pid_t done = waitpid(child, &status, WNOHANG);
+        if (done == child) {
+            break;
+        }
+        if (done < 0 && errno != EINTR) {
+            report_fatal_error(Twine("Lost the solve process: ") +
+                               sys::StrError(errno));
+        }
+        if (pastDeadline(m_solveDeadline)) {
+            kill(child, SIGKILL);
+            waitpid(child, &status, 0);
+            m_killedSolve = true;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        report_fatal_error("The solve failed, see its output above");
+    }
+
+    // Only builds the constraint graph, the points-to sets are read in
+    setSVFOption("read-ander", pointsTo);
+    wpa->runOnModule(svfModule);
+    setSVFOption("read-ander", "");
+    m_pwpa = std::move(wpa);
+    return true;
+}
+
+/**
+ * @brief Free the SVF state (PAG, constraint graph, points-to sets), which is
+ * by far the largest part of our footprint. No alias queries after this.
+ */
+void MVXAA::releaseSolverState() {
+    m_ptrace.reset();
+    if (m_pwpa) {
+        m_pwpa.reset();
+        SVF::LLVMModuleSet::releaseLLVMModuleSet();
+        m_libcModels.release();
+        m_allocSpec.release();
+    }
+}
+
+/**
+ * @brief Switch to summarizing the rest of the guarded region. Any pointer
+ * there may reach a global whose address escapes, so all of those are
+ * relocated whole, on top of what was found precisely so far.
+ *
+ * @param reason Limit that was hit, the dump is marked degraded with it
+ */
+void MVXAA::startSummarizing(const char *reason) {
+    m_summarizing = true;
+    m_degradedReason = reason;
+    addEscapedGlobals();
+}
+
+/**
+ * @brief Relocate whole every global whose address escapes, once per walk.
+ * A summarized function may reach any of them through the pointers it is
+ * handed.
+ */
+void MVXAA::addEscapedGlobals() {
+    if (m_addedEscaped) {
+        return;
+    }
+    m_addedEscaped = true;
+    SetVector<Value *> escaped;
+    conservative::collectAddressTakenGlobals(*m_pmainmodule, *m_pglobals,
+                                             escaped);
+    for (Value *G : escaped) {
+        m_targetGlobals.insert(G);
+        m_pglobalsAndOffsets->markAccess(G, RelocationSet::WHOLE_OBJECT,
+                                         RelocationSet::ESCAPED);
+    }
+}
+
+/**
+ * @brief Queue every defined function whose address is taken, to be walked
+ * like a callback of the guarded function
+ *
+ * @param guardedFunc
+ */
+void MVXAA::queueAddressTakenFunctions(Function *guardedFunc) {
+    for (Function &F : *m_pmainmodule) {
+        if (!F.isDeclaration() && F.hasAddressTaken()) {
+            m_pendingCallbacks.push_back(std::make_pair(&F, guardedFunc));
+        }
+    }
+}
+
+/**
+ * @brief Cheap stand-in for visiting F: every global it names directly
+ *
+ * @param F
+ */
+void MVXAA::summarizeFunction(Function &F) {
+    SetVector<Value *> referenced;
+    conservative::collectReferencedGlobals(F, *m_pglobals, referenced);
+    for (Value *G : referenced) {
+        m_targetGlobals.insert(G);
+        m_pglobalsAndOffsets->markAccess(G, RelocationSet::WHOLE_OBJECT,
+                                         RelocationSet::WRITTEN);
+        m_targetOrigins.insert(std::make_pair(G, &F));
+    }
+    ++m_summarizedFuncs;
+}
+
+/**
+ * @brief Diff this run's relocation set against an earlier dump, fails if the
+ * set grew by more than -mvx-baseline-max-growth records
+ *
+ * @param baselinePath
+ */
+void MVXAA::diffAgainstBaseline(StringRef baselinePath) {
+    RelocationDiff diff;
+    std::string error;
+    if (!diff.loadBaseline(baselinePath, error)) {
+        report_fatal_error(Twine(error));
+    }
+    unsigned growth = diff.diff(*m_pglobalsAndOffsets, outs());
+    if (growth > MVX_BASELINE_MAX_GROWTH) {
+        // Fatal errors skip doFinalization, make sure the dump is complete
+        if (m_pinfoFile) {
+            m_pinfoFile->flush();
+        }
+        report_fatal_error(Twine("Relocation set grew by ") + Twine(growth) +
+                               " records, more than the allowed " +
+                               Twine(MVX_BASELINE_MAX_GROWTH),
+                           false);
     }
 }
 
@@ -158,6 +1607,78 @@ Value *MVXAA::aliasesGlobal(Value *V) const {
     return retVal;
 }
 
+/**
+ * @brief aliasesGlobal, but also records the query to the trace file if
+ * -mvx-record-trace is set
+ *
+ * @param site Which visitor is asking
+ * @param V Value to check against all known globals
+ *
+ * @return Same as aliasesGlobal
+ */
+Value *MVXAA::queryGlobalAlias(QueryTrace::Site site, Value *V) {
+    Value *retVal = aliasesGlobal(V);
+    if (m_ptrace) {
+        m_ptrace->record(site, V, retVal);
+    }
+    return retVal;
+}
+
+/**
+ * @brief Re-run every query of a recorded trace against the current solve
+ * and compare the answers. Exits with an error if any answer differs, so
+ * query engine changes can be checked for identical results.
+ *
+ * @param tracePath
+ */
+void MVXAA::replayTrace(StringRef tracePath) {
+    std::vector<QueryTrace::Query> queries;
+    std::string error;
+    if (!QueryTrace::readTrace(tracePath, queries, error)) {
+        report_fatal_error(Twine(error));
+    }
+
+    // Resolve the ids up front so only the queries themselves are timed
+    std::vector<Value *> values;
+    values.reserve(queries.size());
+    for (const QueryTrace::Query &Q : queries) {
+        Value *V = m_pids->lookup(Q.valueId);
+        if (!V) {
+            report_fatal_error(Twine("Trace value ") + Q.valueId +
+                               " doesn't exist in this module");
+        }
+        values.push_back(V);
+    }
+
+    std::vector<Value *> results(queries.size());
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < queries.size(); ++i) {
+        results[i] = aliasesGlobal(values[i]);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    unsigned mismatches = 0;
+    for (unsigned i = 0; i < queries.size(); ++i) {
+        const QueryTrace::Query &Q = queries[i];
+        std::string resultId = results[i] ? m_pids->getId(results[i]) : "";
+        if (resultId != Q.resultId) {
+            ++mismatches;
+            errs() << "Replay mismatch: " << QueryTrace::siteName(Q.site) << " "
+                   << Q.valueId << " recorded "
+                   << (Q.resultId.empty() ? "-" : Q.resultId) << " got "
+                   << (resultId.empty() ? "-" : resultId) << "\n";
+        }
+    }
+
+    outs() << "Replayed " << queries.size() << " queries in "
+           << elapsed.count() << "us, " << mismatches << " mismatches\n";
+    if (mismatches) {
+        report_fatal_error("Query trace replay doesn't match the recording",
+                           false);
+    }
+}
+
 /**
  * @brief Resolves load instructions loading from a GEP instruction, this is
  the
@@ -183,76 +1704,136 @@ Value *MVXAA::aliasesGlobal(Value *V) const {
  * %struct.struct_type* %2, i32 0, i32 3
  *
  * All we need to do is find the GEP offset to get the member and the base
- aliased global
+ aliased global. Offsets are accumulated in bytes through any chain of GEPs,
+ * constant expression GEPs and casts, and across PHIs and selects.
  * @param gepSet
  */
 void MVXAA::resolveGEPParents(const DenseSet<Value *> &gepSet) {
-    outs() << "GEP SET------------------------------------: \n";
+    logEvent(EventLog::GEPSet, nullptr, nullptr, gepSet.size());
+    const DataLayout &DL = m_pmainmodule->getDataLayout();
     for (Value *V : gepSet) {
-        GetElementPtrInst *GEPinst = dyn_cast<GetElementPtrInst>(V);
-        assert(GEPinst && "Not a GEP Instruction!");
-        outs() << "V: " << *V << "\n";
-        // If the pointerOperand is a Load instruction, then check if that
-        // load aliases any globals. If it does, that is the parent global.
-        // Next, check the offset of the member and push that into the pair.
-        if (LoadInst *LI = dyn_cast<LoadInst>(GEPinst->getPointerOperand())) {
-            if (Value *globalAlias = aliasesGlobal(LI)) {
-                if (GEPinst->getNumOperands() >= 3) {
-                    if (ConstantInt *CI =
-                            dyn_cast<ConstantInt>(GEPinst->getOperand(2))) {
-                        LLVM_DEBUG(dbgs() << "GEP Parent Resolution: "
-                                          << *globalAlias << " offset: "
-                                          << CI->getZExtValue() << "\n";);
-                        m_globalsAndOffsets.insert(GlobalPair_t(
-                            globalAlias->getName(), CI->getZExtValue()));
-                    } else {
-                        // llvm_unreachable("GEP Offset is not a constant
-                        // int!");
-                        LLVM_DEBUG(dbgs()
-                                   << "GEP Offset is not a constant int!\n");
-                    }
-                }
+        logEvent(EventLog::GEPValue, V);
+        // Each base is either a global, or a pointer loaded from memory, in
+        // which case the global that load aliases is the parent. The byte
+        // offset from the base is the offset of the member.
+        SmallVector<PointerBase, 4> bases;
+        decomposePointer(V, DL, bases);
+        for (const PointerBase &B : bases) {
+            if (!B.exact) {
+                logEvent(EventLog::NotConstant, V);
+                continue;
+            }
+            Value *parent = nullptr;
+            if (m_pglobals->count(B.base)) {
+                parent = B.base;
+            } else if (isa<LoadInst>(B.base)) {
+                parent = queryGlobalAlias(QueryTrace::GEPParent, B.base);
             }
-        } else if (m_pglobals->find(GEPinst->getPointerOperand()) !=
-                   m_pglobals->end()) {
-            // The other case, where GEP doesn't have a load instruction but has
-            // the global's symbol as the pointerOperand. This is the case for
-            // loads preceeding function ptrs.
-            Value *globalMatch = GEPinst->getPointerOperand();
-            if (ConstantInt *CI =
-                    dyn_cast<ConstantInt>(GEPinst->getOperand(2))) {
-                LLVM_DEBUG(dbgs()
-                               << "GEP Parent Resolution: " << *globalMatch
-                               << " offset: " << CI->getZExtValue() << "\n";);
-                m_globalsAndOffsets.insert(
-                    GlobalPair_t(globalMatch->getName(), CI->getZExtValue()));
-            } else {
-                // llvm_unreachable("GEP Offset is not a constant int!");
-                LLVM_DEBUG(dbgs() << "GEP Offset is not a constant int!\n");
+            if (!parent) {
+                logEvent(EventLog::NoParent, B.base);
+                continue;
             }
+            if (B.isStrided()) {
+                insertRange(parent, B, getOrigin(V));
+                continue;
+            }
+            logEvent(EventLog::GEPParent, parent, nullptr, B.offset);
+            m_pglobalsAndOffsets->insert(parent, B.offset, getOrigin(V));
         }
     }
 }
 
 /**
- * @brief Helper to print all the globals pair list to the file
+ * @brief Record a dynamically indexed array of pointer-bearing elements of
+ * parent. Without a bound from the array type, the range runs to the end of
+ * the global.
+ *
+ * @param parent
+ * @param B Strided base, relative to the start of parent
+ * @param origin
+ */
+void MVXAA::insertRange(Value *parent, const PointerBase &B,
+                        StringRef origin) {
+    GlobalVariable *G = cast<GlobalVariable>(parent);
+    uint64_t start = B.offset - B.fieldOffset;
+    uint64_t size = m_pmainmodule->getDataLayout().getTypeAllocSize(
+        G->getValueType());
+    if (start >= size) {
+        logEvent(EventLog::RangePastEnd, G);
+        return;
+    }
+    uint64_t count = (size - start) / B.stride;
+    if (B.count) {
+        count = std::min(count, B.count);
+    }
+    logEvent(EventLog::RangeParent, G, nullptr, start);
+    m_pglobalsAndOffsets->insertRange(G, start, B.stride, count,
+                                      B.fieldOffset, origin);
+}
+
+/**
+ * @brief Whether a side file option should be written: with -mvx-metadata
+ * the results travel in the module, so only files asked for explicitly
+ *
+ * @param fileOpt
+ */
+static bool writesSideFile(const cl::opt<std::string> &fileOpt) {
+    return !fileOpt.empty() && (!MVX_METADATA || fileOpt.getNumOccurrences());
+}
+
+/**
+ * @brief Helper to print all the globals pair list to the file, sorted so
+ * the dump is identical between runs on the same module. The strided ranges
+ * and the pointer fixup table go to their own files. Files are only opened
+ * here, so runs that don't get this far leave nothing behind.
  *
  * @param globalsList
  */
-void MVXAA::dumpGlobalsToFile(DenseSet<GlobalPair_t> &globalsList) {
-    for (auto pair : globalsList) {
-        // assert(pair.first.empty() && "Global doesn't have a name!");
-        *m_pinfoFile << pair.first << "," << pair.second << "\n";
+void MVXAA::dumpGlobalsToFile(const RelocationSet &globalsList) {
+    std::error_code E;
+    if (writesSideFile(MVX_DUMP_FILE)) {
+        m_pinfoFile = std::make_unique<raw_fd_ostream>(MVX_DUMP_FILE, E);
+        if (E) {
+            report_fatal_error(Twine("Error opening dump file ") +
+                               MVX_DUMP_FILE + ": " + E.message());
+        }
+        if (m_degradedReason) {
+            // Sound but conservative, consumers skip comment lines
+            *m_pinfoFile << "# degraded: " << m_degradedReason << "\n";
+        }
+        globalsList.write(*m_pinfoFile);
+    }
+
+    if (writesSideFile(MVX_RANGES_DUMP)) {
+        raw_fd_ostream rangesFile(MVX_RANGES_DUMP, E);
+        if (E) {
+            report_fatal_error(Twine("Error opening ranges dump file ") +
+                               MVX_RANGES_DUMP + ": " + E.message());
+        }
+        globalsList.writeRanges(rangesFile);
+    }
+
+    if (writesSideFile(MVX_FIXUPS_DUMP)) {
+        raw_fd_ostream fixupsFile(MVX_FIXUPS_DUMP, E);
+        if (E) {
+            report_fatal_error(Twine("Error opening fixups dump file ") +
+                               MVX_FIXUPS_DUMP + ": " + E.message());
+        }
+        FixupTable(globalsList, m_pmainmodule->getDataLayout())
+            .write(fixupsFile);
     }
 }
 
 void MVXAA::getAnalysisUsage(AnalysisUsage &AU) const {
-    AU.setPreservesAll();
+    if (!MVX_PROMOTE_CALLS) {
+        AU.setPreservesAll();
+    }
     AU.addRequired<CollectGlobals>();
 }
 
 /**
- * @brief Setup file ostream to dump global addresses and offsets to
+ * @brief Pick up the guarded function, the dump file is opened once there
+ * is something to write
  *
  * @param M
  *
@@ -261,16 +1842,12 @@ void MVXAA::getAnalysisUsage(AnalysisUsage &AU) const {
 bool MVXAA::doInitialization(Module &M) {
     m_mvxFunc = MVX_FUNC;
     LLVM_DEBUG(dbgs() << "MVX func: " << m_mvxFunc << "\n");
-    std::error_code E;
-    assert((m_pinfoFile =
-                std::make_unique<raw_fd_ostream>("global_addresses.dump", E)) &&
-           "Error opening dump file!");
     return false;
 }
 
 bool MVXAA::doFinalization(Module &M) {
     // Close file
-    m_pinfoFile->close();
+    m_pinfoFile.reset();
     return false;
 }
 char MVXAA::ID = 0;
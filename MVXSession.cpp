@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <CollectGlobals.hpp>
+#include <MVXSession.hpp>
+
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/SourceMgr.h>
+
+using namespace llvm;
+
+// The session whose module SVF currently holds, and the backend selected
+// for the process
+static MVXSession *SolvedSession = nullptr;
+static std::string SelectedBackend;
+
+/**
+ * @brief Parse a bitcode or textual IR module into a session of its own
+ *
+ * @param path
+ * @param error
+ *
+ * @return nullptr on failure, with error set
+ */
+std::unique_ptr<MVXSession> MVXSession::load(StringRef path,
+                                             std::string &error) {
+    auto context = std::make_unique<LLVMContext>();
+    SMDiagnostic diag;
+    std::unique_ptr<Module> M = parseIRFile(path, diag, *context);
+    if (!M) {
+        error = "Can't load " + path.str() + ": " + diag.getMessage().str();
+        return nullptr;
+    }
+    return std::make_unique<MVXSession>(std::move(context), std::move(M));
+}
+
+MVXSession::MVXSession(std::unique_ptr<LLVMContext> context,
+                       std::unique_ptr<Module> M)
+    : m_pcontext(std::move(context)), m_pmodule(std::move(M)) {}
+
+MVXSession::~MVXSession() { release(); }
+
+/**
+ * @brief Select the SVF analysis by the name of its option, "fspta",
+ * "sfrander", ... as for opt. SVF keeps them in a cl::bits, which can't be
+ * cleared, so a process sticks to its first backend.
+ *
+ * @return false on failure, with error set
+ */
+bool MVXSession::selectBackend(StringRef backend, std::string &error) {
+    if (backend == SelectedBackend) {
+        return true;
+    }
+    if (!SelectedBackend.empty()) {
+        error = "This process already solves with -" + SelectedBackend +
+                ", SVF can't switch to -" + backend.str();
+        return false;
+    }
+    StringMap<cl::Option *> &options = cl::getRegisteredOptions();
+    auto it = options.find(backend);
+    if (it == options.end()) {
+        error = "SVF has no -" + backend.str() + " analysis";
+        return false;
+    }
+    if (it->second->getNumOccurrences()) {
+        error = "An SVF analysis was already selected on the command line";
+        return false;
+    }
+    if (it->second->addOccurrence(0, backend, "")) {
+        error = "Can't select -" + backend.str();
+        return false;
+    }
+    SelectedBackend = backend.str();
+    return true;
+}
+
+/**
+ * @brief Solve the module, held until release
+ *
+ * @param backend SVF analysis, empty for the one selected on the command
+ * line
+ * @param error
+ *
+ * @return false on failure, with error set
+ */
+bool MVXSession::solve(StringRef backend, std::string &error) {
+    if (m_panalysis) {
+        return true;
+    }
+    if (SolvedSession) {
+        error = "Another session holds the solve, SVF analyzes a single "
+                "module per process";
+        return false;
+    }
+    if (!backend.empty() && !selectBackend(backend, error)) {
+        return false;
+    }
+    CollectGlobals collect;
+    collect.runOnModule(*m_pmodule);
+    m_panalysis = std::make_unique<MVXAA>();
+    m_panalysis->prepare(*m_pmodule, collect.getResult());
+    SolvedSession = this;
+    return true;
+}
+
+bool MVXSession::isDegraded() const {
+    return m_panalysis && m_panalysis->isDegraded();
+}
+
+/**
+ * @brief Relocation set of the region guarded by a function, valid until the
+ * next analyze or release
+ *
+ * @param guardedFunc Name of a function defined in the module
+ * @param error
+ *
+ * @return nullptr on failure, with error set
+ */
+const RelocationSet *MVXSession::analyze(StringRef guardedFunc,
+                                         std::string &error) {
+    if (!m_panalysis) {
+        error = "The session isn't solved";
+        return nullptr;
+    }
+    Function *F = m_pmodule->getFunction(guardedFunc);
+    if (!F || F->isDeclaration()) {
+        error = "No function " + guardedFunc.str() + " defined in the module";
+        return nullptr;
+    }
+    m_panalysis->resetWalk();
+    m_panalysis->analyzeGuarded(F);
+    return &m_panalysis->getRelocations();
+}
+
+/**
+ * @brief Free the solve, the module stays loaded and can be solved again
+ */
+void MVXSession::release() {
+    if (!m_panalysis) {
+        return;
+    }
+    m_panalysis->releaseSolverState();
+    m_panalysis.reset();
+    SolvedSession = nullptr;
+}
@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <ModRefSummaries.hpp>
+
+#include <llvm/ADT/SCCIterator.h>
+#include <llvm/ADT/SetVector.h>
+#include <llvm/Support/ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#define DEBUG_TYPE "mvxaa"
+
+using namespace llvm;
+
+void ModRefSummaries::Summary::merge(const Summary &other) {
+    records.insert(other.records.begin(), other.records.end());
+    ranges.insert(other.ranges.begin(), other.ranges.end());
+    for (const auto &access : other.accesses) {
+        auto it = accesses.insert(access).first;
+        it->second = std::max(it->second, access.second);
+    }
+    indirectCalls.insert(other.indirectCalls.begin(),
+                         other.indirectCalls.end());
+}
+
+ModRefSummaries::ModRefSummaries(Module &M) : m_graph(M) {
+    // Filled up front so references from getLocal stay valid
+    for (Function &F : M) {
+        if (!F.isDeclaration()) {
+            m_local[&F];
+        }
+    }
+}
+
+/**
+ * @brief Local facts of a defined function, to be filled before propagate
+ *
+ * @param F
+ *
+ * @return
+ */
+ModRefSummaries::Summary &ModRefSummaries::getLocal(const Function *F) {
+    auto it = m_local.find(F);
+    assert(it != m_local.end() && "No summary for a declaration!");
+    return it->second;
+}
+
+/**
+ * @brief Add a call edge the call graph doesn't have, like a library
+ * callback or a call through a constant table
+ *
+ * @param caller
+ * @param callee
+ */
+void ModRefSummaries::addCallee(Function *caller, Function *callee) {
+    m_graph.getOrInsertFunction(caller)->addCalledFunction(
+        nullptr, m_graph.getOrInsertFunction(callee));
+}
+
+/**
+ * @brief Compute every SCC's summary from its members' local facts and the
+ * summaries of the SCCs it calls
+ *
+ * @param threads 0 to use all hardware threads
+ */
+void ModRefSummaries::propagate(unsigned threads) {
+    // scc_iterator hands out SCCs bottom-up, callees first
+    std::vector<std::vector<CallGraphNode *>> sccs;
+    DenseMap<const CallGraphNode *, unsigned> sccOfNode;
+    for (scc_iterator<CallGraph *> I = scc_begin(&m_graph); !I.isAtEnd();
+         ++I) {
+        for (CallGraphNode *node : *I) {
+            sccOfNode[node] = sccs.size();
+        }
+        sccs.push_back(*I);
+    }
+
+    unsigned numSCCs = sccs.size();
+    std::vector<SmallSetVector<unsigned, 4>> callees(numSCCs);
+    std::vector<SmallVector<unsigned, 4>> callers(numSCCs);
+    for (unsigned i = 0; i < numSCCs; ++i) {
+        for (CallGraphNode *node : sccs[i]) {
+            if (const Function *F = node->getFunction()) {
+                m_sccOf[F] = i;
+            }
+            for (const CallGraphNode::CallRecord &edge : *node) {
+                unsigned callee = sccOfNode.lookup(edge.second);
+                if (callee != i && callees[i].insert(callee)) {
+                    callers[callee].push_back(i);
+                }
+            }
+        }
+    }
+
+    // An SCC is ready once the count of SCCs it calls and that aren't done
+    // yet drops to 0
+    std::unique_ptr<std::atomic<unsigned>[]> pending(
+        new std::atomic<unsigned>[numSCCs]);
+    for (unsigned i = 0; i < numSCCs; ++i) {
+        pending[i] = callees[i].size();
+    }
+    m_sccSummaries.assign(numSCCs, Summary());
+
+    ThreadPool pool(hardware_concurrency(threads));
+    std::function<void(unsigned)> summarizeSCC = [&](unsigned i) {
+        Summary &S = m_sccSummaries[i];
+        bool hasFunction = false;
+        for (CallGraphNode *node : sccs[i]) {
+            if (const Function *F = node->getFunction()) {
+                hasFunction = true;
+                auto it = m_local.find(F);
+                if (it != m_local.end()) {
+                    S.merge(it->second);
+                }
+            }
+        }
+        // The external calling node reaches everything, and nothing asks
+        // for its summary
+        if (hasFunction) {
+            for (unsigned callee : callees[i]) {
+                S.merge(m_sccSummaries[callee]);
+            }
+        }
+        for (unsigned caller : callers[i]) {
+            if (--pending[caller] == 0) {
+                pool.async(summarizeSCC, caller);
+            }
+        }
+    };
+    for (unsigned i = 0; i < numSCCs; ++i) {
+        if (callees[i].empty()) {
+            pool.async(summarizeSCC, i);
+        }
+    }
+    pool.wait();
+    LLVM_DEBUG(dbgs() << "Summarized " << numSCCs << " SCCs\n");
+}
+
+/**
+ * @brief Summary of F including everything it calls
+ *
+ * @param F
+ *
+ * @return nullptr if F isn't in the call graph or propagate hasn't run
+ */
+const ModRefSummaries::Summary *
+ModRefSummaries::lookup(const Function *F) const {
+    auto it = m_sccOf.find(F);
+    return it == m_sccOf.end() ? nullptr : &m_sccSummaries[it->second];
+}
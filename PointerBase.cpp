@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <PointerBase.hpp>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/GetElementPtrTypeIterator.h>
+#include <llvm/IR/Operator.h>
+
+using namespace llvm;
+
+// Past this many bases the rest of a PHI/select web is left undecomposed
+#define MAX_BASES (16)
+
+/**
+ * @brief Add a GEP's offset to cur, which so far holds the offset of the
+ * GEPs outside it. Indices past a non-constant one are part of the field
+ * offset within the strided element, as is everything outside the GEP.
+ *
+ * @param GEP
+ * @param DL
+ * @param cur
+ */
+static void accumulateGEP(GEPOperator *GEP, const DataLayout &DL,
+                          PointerBase &cur) {
+    int64_t total = 0;
+    int64_t afterVariable = 0;
+    bool seenVariable = false;
+    // Number of elements of the array the current index steps through, 0 for
+    // the leading index which steps over the pointer
+    uint64_t numElements = 0;
+    for (gep_type_iterator GTI = gep_type_begin(GEP), E = gep_type_end(GEP);
+         GTI != E; ++GTI) {
+        int64_t step;
+        if (StructType *ST = GTI.getStructTypeOrNull()) {
+            unsigned field =
+                cast<ConstantInt>(GTI.getOperand())->getZExtValue();
+            step = DL.getStructLayout(ST)->getElementOffset(field);
+            numElements = 0;
+        } else {
+            uint64_t size = DL.getTypeAllocSize(GTI.getIndexedType());
+            ConstantInt *CI = dyn_cast<ConstantInt>(GTI.getOperand());
+            if (!CI) {
+                if (seenVariable || cur.stride) {
+                    // Only one stride can be described
+                    cur.exact = false;
+                    return;
+                }
+                seenVariable = true;
+                cur.stride = size;
+                cur.count = numElements;
+                afterVariable = 0;
+                continue;
+            }
+            step = CI->getSExtValue() * (int64_t)size;
+        }
+        total += step;
+        if (seenVariable) {
+            afterVariable += step;
+        }
+        Type *indexed = GTI.getIndexedType();
+        numElements = isa<ArrayType>(indexed)
+                          ? cast<ArrayType>(indexed)->getNumElements()
+                          : 0;
+    }
+    if (seenVariable) {
+        cur.fieldOffset = cur.offset + afterVariable;
+    }
+    cur.offset += total;
+}
+
+/**
+ * @brief Decompose ptr into the objects it may point into. Casts and GEPs,
+ * instructions or constant expressions, are looked through and their
+ * constant offsets accumulated in bytes. A single non-constant index makes
+ * the pointer strided, more make it inexact. PHIs and selects fan out to
+ * each incoming value.
+ *
+ * @param ptr
+ * @param DL
+ * @param bases Every base found, with its offset, not deduplicated
+ */
+void decomposePointer(Value *ptr, const DataLayout &DL,
+                      SmallVectorImpl<PointerBase> &bases) {
+    // Offset each PHI/select was first reached at, to spot cycles that
+    // advance the pointer
+    DenseMap<Value *, int64_t> merges;
+    bool cycleMoves = false;
+    SmallVector<PointerBase, 8> worklist;
+    worklist.push_back(PointerBase{ptr, 0, true, 0, 0, 0});
+    while (!worklist.empty()) {
+        PointerBase cur = worklist.pop_back_val();
+        while (true) {
+            if (Operator::getOpcode(cur.base) == Instruction::BitCast ||
+                Operator::getOpcode(cur.base) == Instruction::AddrSpaceCast) {
+                cur.base = cast<Operator>(cur.base)->getOperand(0);
+            } else if (GEPOperator *GEP = dyn_cast<GEPOperator>(cur.base)) {
+                if (cur.exact) {
+                    accumulateGEP(GEP, DL, cur);
+                }
+                cur.base = GEP->getPointerOperand();
+            } else {
+                break;
+            }
+        }
+
+        if (isa<PHINode>(cur.base) || isa<SelectInst>(cur.base)) {
+            auto inserted = merges.insert(std::make_pair(cur.base, cur.offset));
+            if (!inserted.second) {
+                if (inserted.first->second != cur.offset || !cur.exact) {
+                    cycleMoves = true;
+                }
+                continue;
+            }
+            if (bases.size() + worklist.size() < MAX_BASES) {
+                if (PHINode *PN = dyn_cast<PHINode>(cur.base)) {
+                    for (Value *incoming : PN->incoming_values()) {
+                        PointerBase next = cur;
+                        next.base = incoming;
+                        worklist.push_back(next);
+                    }
+                } else {
+                    SelectInst *SI = cast<SelectInst>(cur.base);
+                    for (Value *V : {SI->getTrueValue(), SI->getFalseValue()}) {
+                        PointerBase next = cur;
+                        next.base = V;
+                        worklist.push_back(next);
+                    }
+                }
+                continue;
+            }
+            cur.exact = false;
+        }
+        cur.exact = cur.exact && cur.offset >= 0 &&
+                    cur.offset - cur.fieldOffset >= 0 && cur.fieldOffset >= 0;
+        bases.push_back(cur);
+    }
+    if (cycleMoves) {
+        for (PointerBase &B : bases) {
+            B.exact = false;
+        }
+    }
+}
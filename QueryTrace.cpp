@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <QueryTrace.hpp>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+using namespace llvm;
+
+static const char *const TRACE_HEADER = "# mvx-query-trace v1";
+
+StringRef QueryTrace::siteName(Site S) {
+    switch (S) {
+    case LoadPtr:
+        return "load-ptr";
+    case LoadVal:
+        return "load-val";
+    case CallPtr:
+        return "call-ptr";
+    case CallArg:
+        return "call-arg";
+    case GEPParent:
+        return "gep-parent";
+    }
+    llvm_unreachable("Unknown query site!");
+}
+
+bool QueryTrace::parseSite(StringRef name, Site &S) {
+    for (Site candidate : {LoadPtr, LoadVal, CallPtr, CallArg, GEPParent}) {
+        if (siteName(candidate) == name) {
+            S = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QueryTrace::QueryTrace(StableValueIds &ids, std::unique_ptr<raw_fd_ostream> out)
+    : m_ids(ids), m_pout(std::move(out)) {
+    *m_pout << TRACE_HEADER << "\n";
+}
+
+QueryTrace::~QueryTrace() { m_pout->close(); }
+
+/**
+ * @brief Append one query and its answer to the trace
+ *
+ * @param S Which visitor asked
+ * @param V Value that was checked against the globals
+ * @param result Global it aliases, nullptr if none
+ */
+void QueryTrace::record(Site S, const Value *V, const Value *result) {
+    std::string id = m_ids.getId(V);
+    if (id.empty()) {
+        // Constant expressions etc. have no stable id, skip them rather than
+        // writing a line that can't be replayed.
+        return;
+    }
+    *m_pout << siteName(S) << " " << id << " "
+            << (result ? m_ids.getId(result) : "-") << "\n";
+}
+
+/**
+ * @brief Parse a trace written by record()
+ *
+ * @param path
+ * @param queries Parsed queries, in recording order
+ * @param error Set on failure
+ *
+ * @return false if the file can't be read or is malformed
+ */
+bool QueryTrace::readTrace(StringRef path, std::vector<Query> &queries,
+                           std::string &error) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> buf = MemoryBuffer::getFile(path);
+    if (!buf) {
+        error = "can't read " + path.str() + ": " + buf.getError().message();
+        return false;
+    }
+    SmallVector<StringRef, 0> lines;
+    (*buf)->getBuffer().split(lines, '\n', -1, false);
+    if (lines.empty() || lines.front().rtrim() != TRACE_HEADER) {
+        error = path.str() + " is not a query trace";
+        return false;
+    }
+    for (unsigned i = 1; i < lines.size(); ++i) {
+        SmallVector<StringRef, 3> fields;
+        lines[i].rtrim().split(fields, ' ');
+        Query Q;
+        if (fields.size() != 3 || !parseSite(fields[0], Q.site)) {
+            error = path.str() + ":" + std::to_string(i + 1) +
+                    ": malformed query";
+            return false;
+        }
+        Q.valueId = fields[1].str();
+        Q.resultId = fields[2] == "-" ? "" : fields[2].str();
+        queries.push_back(Q);
+    }
+    return true;
+}
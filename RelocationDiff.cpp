@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <RelocationDiff.hpp>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+using namespace llvm;
+
+/**
+ * @brief Read a global_addresses.dump written by an earlier run. Only the
+ * leading "name,offset" fields are used, comment lines start with '#'.
+ *
+ * @param path
+ * @param error Set on failure
+ *
+ * @return false if the file can't be read or is malformed
+ */
+bool RelocationDiff::loadBaseline(StringRef path, std::string &error) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> buf = MemoryBuffer::getFile(path);
+    if (!buf) {
+        error = "can't read " + path.str() + ": " + buf.getError().message();
+        return false;
+    }
+    SmallVector<StringRef, 0> lines;
+    (*buf)->getBuffer().split(lines, '\n', -1, false);
+    for (unsigned i = 0; i < lines.size(); ++i) {
+        StringRef line = lines[i].trim();
+        if (line.empty() || line.startswith("#")) {
+            continue;
+        }
+        SmallVector<StringRef, 3> fields;
+        line.split(fields, ',');
+        unsigned offset;
+        if (fields.size() < 2 || fields[1].getAsInteger(10, offset)) {
+            error = path.str() + ":" + std::to_string(i + 1) +
+                    ": malformed record";
+            return false;
+        }
+        m_baseline.insert(NamedRecord_t(fields[0].str(), offset));
+    }
+    return true;
+}
+
+/**
+ * @brief Report records added and removed relative to the baseline. Added
+ * records are listed with the guarded call path that produced them.
+ *
+ * @param current Result of this run
+ * @param report
+ *
+ * @return Number of records the set grew by, 0 if it didn't grow
+ */
+unsigned RelocationDiff::diff(const RelocationSet &current,
+                              raw_ostream &report) {
+    std::set<NamedRecord_t> seen;
+    unsigned added = 0;
+    for (const RelocationSet::Record_t &R : current) {
+        NamedRecord_t named(current.getGlobal(R)->getName().str(), R.second);
+        seen.insert(named);
+        if (!m_baseline.count(named)) {
+            ++added;
+            report << "+ " << named.first << "," << named.second;
+            StringRef origin = current.getOrigin(R);
+            if (!origin.empty()) {
+                report << "  [" << origin << "]";
+            }
+            report << "\n";
+        }
+    }
+
+    unsigned removed = 0;
+    for (const NamedRecord_t &named : m_baseline) {
+        if (!seen.count(named)) {
+            ++removed;
+            report << "- " << named.first << "," << named.second << "\n";
+        }
+    }
+
+    report << "Relocation set: " << m_baseline.size() << " -> "
+           << current.size() << " (" << added << " added, " << removed
+           << " removed)\n";
+    return current.size() > m_baseline.size()
+               ? current.size() - m_baseline.size()
+               : 0;
+}
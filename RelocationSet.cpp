@@ -0,0 +1,284 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <RelocationSet.hpp>
+
+#include <llvm/IR/Constants.h>
+
+#include <algorithm>
+
+using namespace llvm;
+
+const char *const RelocationSet::RELOCATIONS_MD = "mvx.relocations";
+const char *const RelocationSet::RANGES_MD = "mvx.ranges";
+const char *const RelocationSet::GLOBAL_MD = "mvx.relocate";
+
+RelocationSet::RelocationSet(Module &M) {
+    for (GlobalVariable &G : M.globals()) {
+        m_globalIndex[&G] = m_globals.size();
+        m_globals.push_back(&G);
+    }
+}
+
+/**
+ * @brief Keep the shorter of two call paths, by number of calls and then
+ * lexicographically, so the origin doesn't depend on the order records are
+ * found in
+ *
+ * @param kept Origin so far, empty if none
+ * @param origin
+ */
+static void keepShorterOrigin(std::string &kept, StringRef origin) {
+    if (origin.empty()) {
+        return;
+    }
+    size_t keptCalls = StringRef(kept).count(" > ");
+    size_t calls = origin.count(" > ");
+    if (kept.empty() || calls < keptCalls ||
+        (calls == keptCalls && origin < StringRef(kept))) {
+        kept = origin.str();
+    }
+}
+
+/**
+ * @brief Add a record, duplicates are ignored
+ *
+ * @param global Must be one of the module's global variables
+ * @param offset
+ * @param origin Call path that produced the record, the shortest one is kept
+ *
+ * @return true if the record wasn't already in the set
+ */
+bool RelocationSet::insert(Value *global, unsigned offset, StringRef origin) {
+    auto it = m_globalIndex.find(global);
+    assert(it != m_globalIndex.end() && "Not a global of this module!");
+    Record_t R(it->second, offset);
+    bool inserted = m_records.insert(R).second;
+    if (!origin.empty()) {
+        keepShorterOrigin(m_origins[R], origin);
+    }
+    return inserted;
+}
+
+/**
+ * @brief Drop all records and accesses, the globals stay interned
+ */
+void RelocationSet::clear() {
+    m_records.clear();
+    m_origins.clear();
+    m_access.clear();
+    m_ranges.clear();
+    m_rangeOrigins.clear();
+}
+
+StringRef RelocationSet::getOrigin(const Record_t &R) const {
+    auto it = m_origins.find(R);
+    return it == m_origins.end() ? StringRef() : StringRef(it->second);
+}
+
+/**
+ * @brief Add a strided range record, duplicates are ignored
+ *
+ * @param global Must be one of the module's global variables
+ * @param start Byte offset of the first element
+ * @param stride Element size
+ * @param count Number of elements
+ * @param fieldOffset Byte offset of the pointer within each element
+ * @param origin Call path that produced the range, the shortest one is kept
+ *
+ * @return true if the range wasn't already in the set
+ */
+bool RelocationSet::insertRange(Value *global, uint64_t start,
+                                uint64_t stride, uint64_t count,
+                                uint64_t fieldOffset, StringRef origin) {
+    auto it = m_globalIndex.find(global);
+    assert(it != m_globalIndex.end() && "Not a global of this module!");
+    Range_t R = {it->second, start, stride, count, fieldOffset};
+    bool inserted = m_ranges.insert(R).second;
+    if (!origin.empty()) {
+        keepShorterOrigin(m_rangeOrigins[R], origin);
+    }
+    return inserted;
+}
+
+/**
+ * @brief Note that the guarded region accesses offset of global as A, the
+ * most restrictive access noted is kept
+ *
+ * @param global Must be one of the module's global variables
+ * @param offset WHOLE_OBJECT if it isn't known
+ * @param A
+ */
+void RelocationSet::markAccess(Value *global, unsigned offset, Access A) {
+    auto it = m_globalIndex.find(global);
+    assert(it != m_globalIndex.end() && "Not a global of this module!");
+    Access &current =
+        m_access.insert(std::make_pair(Record_t(it->second, offset), READ_ONLY))
+            .first->second;
+    current = std::max(current, A);
+}
+
+/**
+ * @brief How the guarded region accesses a record, accesses to the whole
+ * global count for every offset of it
+ *
+ * @param R
+ *
+ * @return READ_ONLY unless something else was marked
+ */
+RelocationSet::Access RelocationSet::getAccess(const Record_t &R) const {
+    Access A = READ_ONLY;
+    for (unsigned offset : {R.second, WHOLE_OBJECT}) {
+        auto it = m_access.find(Record_t(R.first, offset));
+        if (it != m_access.end()) {
+            A = std::max(A, it->second);
+        }
+    }
+    return A;
+}
+
+StringRef RelocationSet::accessName(Access A) {
+    switch (A) {
+    case READ_ONLY:
+        return "ro";
+    case WRITTEN:
+        return "written";
+    case ESCAPED:
+        return "escaped";
+    }
+    llvm_unreachable("Unknown access");
+}
+
+/**
+ * @brief Write the records as "name,offset,access" lines in sorted order
+ *
+ * @param OS Buffered stream to write to
+ */
+void RelocationSet::write(raw_ostream &OS) const {
+    for (const Record_t &R : m_records) {
+        OS << getGlobal(R)->getName() << "," << R.second << ","
+           << accessName(getAccess(R)) << "\n";
+    }
+}
+
+/**
+ * @brief Write the ranges as "name,start,stride,count,field offset" lines in
+ * sorted order
+ *
+ * @param OS Buffered stream to write to
+ */
+void RelocationSet::writeRanges(raw_ostream &OS) const {
+    for (const Range_t &R : m_ranges) {
+        OS << getGlobal(R.global)->getName() << "," << R.start << ","
+           << R.stride << "," << R.count << "," << R.fieldOffset << "\n";
+    }
+}
+
+/**
+ * @brief Attach the set to the module it was built from, replacing what an
+ * earlier run attached:
+ *   !mvx.relocations = !{!{ptr @global, i64 offset, !"access"}, ...}
+ *   !mvx.ranges = !{!{ptr @global, i64 start, i64 stride, i64 count,
+ *                     i64 field offset}, ...}
+ * and each relocated global gets !mvx.relocate !{i64 offset, ...}
+ *
+ * @param M
+ */
+void RelocationSet::attachMetadata(Module &M) const {
+    LLVMContext &C = M.getContext();
+    Type *I64 = Type::getInt64Ty(C);
+    auto constant = [&](uint64_t value) {
+        return ConstantAsMetadata::get(ConstantInt::get(I64, value));
+    };
+    for (const char *name : {RELOCATIONS_MD, RANGES_MD}) {
+        if (NamedMDNode *old = M.getNamedMetadata(name)) {
+            M.eraseNamedMetadata(old);
+        }
+    }
+    for (GlobalVariable *G : m_globals) {
+        G->setMetadata(GLOBAL_MD, nullptr);
+    }
+
+    NamedMDNode *relocations = M.getOrInsertNamedMetadata(RELOCATIONS_MD);
+    std::vector<Metadata *> offsets;
+    for (auto it = m_records.begin(); it != m_records.end(); ++it) {
+        GlobalVariable *G = getGlobal(*it);
+        relocations->addOperand(MDTuple::get(
+            C, {ValueAsMetadata::get(G), constant(it->second),
+                MDString::get(C, accessName(getAccess(*it)))}));
+        offsets.push_back(constant(it->second));
+        auto next = std::next(it);
+        if (next == m_records.end() || next->first != it->first) {
+            G->setMetadata(GLOBAL_MD, MDTuple::get(C, offsets));
+            offsets.clear();
+        }
+    }
+
+    NamedMDNode *ranges = M.getOrInsertNamedMetadata(RANGES_MD);
+    for (const Range_t &R : m_ranges) {
+        ranges->addOperand(MDTuple::get(
+            C, {ValueAsMetadata::get(getGlobal(R.global)), constant(R.start),
+                constant(R.stride), constant(R.count),
+                constant(R.fieldOffset)}));
+    }
+}
+
+/**
+ * @brief Add the records, accesses and ranges attached by attachMetadata,
+ * entries whose global was since deleted are skipped
+ *
+ * @param M Module the set was built from
+ *
+ * @return false if the module has no !mvx.relocations or it is malformed
+ */
+bool RelocationSet::loadMetadata(const Module &M) {
+    const NamedMDNode *relocations = M.getNamedMetadata(RELOCATIONS_MD);
+    if (!relocations) {
+        return false;
+    }
+    auto global = [&](const MDOperand &op) -> GlobalVariable * {
+        auto *V = dyn_cast_or_null<ValueAsMetadata>(op.get());
+        return V ? dyn_cast<GlobalVariable>(V->getValue()) : nullptr;
+    };
+    auto constant = [](const MDOperand &op, uint64_t &value) {
+        auto *C = mdconst::dyn_extract_or_null<ConstantInt>(op.get());
+        if (C) {
+            value = C->getZExtValue();
+        }
+        return C != nullptr;
+    };
+
+    for (const MDNode *N : relocations->operands()) {
+        uint64_t offset;
+        if (N->getNumOperands() != 3 || !constant(N->getOperand(1), offset)) {
+            return false;
+        }
+        GlobalVariable *G = global(N->getOperand(0));
+        auto *access = dyn_cast_or_null<MDString>(N->getOperand(2).get());
+        if (!G || !m_globalIndex.count(G) || !access) {
+            continue;
+        }
+        insert(G, offset);
+        for (Access A : {READ_ONLY, WRITTEN, ESCAPED}) {
+            if (access->getString() == accessName(A)) {
+                markAccess(G, offset, A);
+            }
+        }
+    }
+    if (const NamedMDNode *ranges = M.getNamedMetadata(RANGES_MD)) {
+        for (const MDNode *N : ranges->operands()) {
+            uint64_t fields[4];
+            if (N->getNumOperands() != 5) {
+                return false;
+            }
+            for (unsigned i = 0; i < 4; ++i) {
+                if (!constant(N->getOperand(i + 1), fields[i])) {
+                    return false;
+                }
+            }
+            GlobalVariable *G = global(N->getOperand(0));
+            if (G && m_globalIndex.count(G)) {
+                insertRange(G, fields[0], fields[1], fields[2], fields[3]);
+            }
+        }
+    }
+    return true;
+}
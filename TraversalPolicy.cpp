@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <TraversalPolicy.hpp>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+using namespace llvm;
+
+TraversalPolicy::TraversalPolicy()
+    : m_defaultBudget(NO_LIMIT), m_maxDepth(NO_LIMIT) {}
+
+/**
+ * @brief Add the rules of a policy file, see the class comment for the format
+ *
+ * @param path
+ * @param error Set on failure
+ *
+ * @return false if the file can't be read or is malformed
+ */
+bool TraversalPolicy::loadFile(StringRef path, std::string &error) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> buf = MemoryBuffer::getFile(path);
+    if (!buf) {
+        error = "can't read " + path.str() + ": " + buf.getError().message();
+        return false;
+    }
+    SmallVector<StringRef, 0> lines;
+    (*buf)->getBuffer().split(lines, '\n', -1, false);
+    for (unsigned i = 0; i < lines.size(); ++i) {
+        StringRef line = lines[i].split('#').first.trim();
+        if (line.empty()) {
+            continue;
+        }
+        SmallVector<StringRef, 3> fields;
+        line.split(fields, ' ', -1, false);
+        unsigned limit;
+        bool ok = true;
+        if (fields[0] == "opaque" && fields.size() == 2) {
+            m_functions[fields[1]] = OPAQUE;
+        } else if (fields[0] == "summarize" && fields.size() == 2) {
+            m_functions[fields[1]] = SUMMARIZE;
+        } else if (fields[0] == "max-depth" && fields.size() == 2) {
+            ok = !fields[1].getAsInteger(10, m_maxDepth);
+        } else if (fields[0] == "budget" && fields.size() == 2) {
+            ok = !fields[1].getAsInteger(10, m_defaultBudget);
+        } else if (fields[0] == "budget" && fields.size() == 3) {
+            ok = !fields[2].getAsInteger(10, limit);
+            m_budgets[fields[1]] = limit;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            error = path.str() + ":" + std::to_string(i + 1) +
+                    ": expected 'opaque|summarize <function>', "
+                    "'max-depth <N>' or 'budget [function] <N>'";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief What the walk should do with F, reached depth calls away from
+ * where it started
+ *
+ * @param F
+ * @param depth 0 for the guarded function
+ *
+ * @return
+ */
+TraversalPolicy::Action TraversalPolicy::decide(const Function &F,
+                                                unsigned depth) const {
+    auto it = m_functions.find(F.getName());
+    if (it != m_functions.end()) {
+        return it->second;
+    }
+    if (depth > m_maxDepth) {
+        return TOO_DEEP;
+    }
+    auto budgetIt = m_budgets.find(F.getName());
+    unsigned budget =
+        budgetIt == m_budgets.end() ? m_defaultBudget : budgetIt->second;
+    if (budget != NO_LIMIT && F.getInstructionCount() > budget) {
+        return OVER_BUDGET;
+    }
+    return VISIT;
+}
+
+StringRef TraversalPolicy::actionName(Action A) {
+    switch (A) {
+    case VISIT:
+        return "visit";
+    case OPAQUE:
+        return "opaque";
+    case SUMMARIZE:
+        return "summarize";
+    case OVER_BUDGET:
+        return "over-budget";
+    case TOO_DEEP:
+        return "too-deep";
+    }
+    llvm_unreachable("Unknown action");
+}
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <ValueIds.hpp>
+#include <llvm/IR/InstIterator.h>
+
+using namespace llvm;
+
+StableValueIds::StableValueIds(Module &M) : m_pmodule(&M) { numberGlobals(); }
+
+/**
+ * @brief Globals are numbered eagerly since lookups by id may name any of
+ * them. Unnamed globals fall back to their position in the module.
+ */
+void StableValueIds::numberGlobals() {
+    unsigned idx = 0;
+    for (GlobalValue &GV : m_pmodule->global_values()) {
+        std::string id = GV.hasName() ? ("@" + GV.getName()).str()
+                                      : "@#" + std::to_string(idx);
+        m_ids[&GV] = id;
+        m_values[id] = &GV;
+        ++idx;
+    }
+}
+
+/**
+ * @brief Function bodies are numbered lazily, the first time one of their
+ * values is asked about.
+ *
+ * @param F
+ */
+void StableValueIds::numberFunction(const Function &F) {
+    if (!m_numberedFuncs.insert(&F).second) {
+        return;
+    }
+    std::string prefix = m_ids.lookup(&F).substr(1);
+    for (const Argument &A : F.args()) {
+        std::string id = prefix + "%arg" + std::to_string(A.getArgNo());
+        m_ids[&A] = id;
+        m_values[id] = const_cast<Argument *>(&A);
+    }
+    unsigned idx = 0;
+    for (const Instruction &I : instructions(F)) {
+        std::string id = prefix + "#" + std::to_string(idx++);
+        m_ids[&I] = id;
+        m_values[id] = const_cast<Instruction *>(&I);
+    }
+}
+
+/**
+ * @brief Get the stable id of a value, values that have no stable position
+ * (e.g. constant expressions) get an empty id.
+ *
+ * @param V
+ *
+ * @return
+ */
+std::string StableValueIds::getId(const Value *V) {
+    if (const Instruction *I = dyn_cast<Instruction>(V)) {
+        numberFunction(*I->getFunction());
+    } else if (const Argument *A = dyn_cast<Argument>(V)) {
+        numberFunction(*A->getParent());
+    }
+    return m_ids.lookup(V);
+}
+
+/**
+ * @brief Reverse of getId
+ *
+ * @param id
+ *
+ * @return nullptr if the id doesn't name any value in the module
+ */
+Value *StableValueIds::lookup(StringRef id) {
+    if (Value *V = m_values.lookup(id)) {
+        return V;
+    }
+    // Instruction or argument ids are prefixed with the function name
+    size_t sep = id.find_last_of("#%");
+    if (sep == StringRef::npos || sep == 0) {
+        return nullptr;
+    }
+    if (Function *F = m_pmodule->getFunction(id.substr(0, sep))) {
+        numberFunction(*F);
+    }
+    return m_values.lookup(id);
+}
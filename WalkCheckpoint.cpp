@@ -0,0 +1,307 @@
+////////////////////////////////////////////////////////////////////////////////
+#include <WalkCheckpoint.hpp>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+static const char *const HEADER = "mvx-checkpoint 2";
+
+WalkCheckpoint::WalkCheckpoint(StringRef dir, StringRef moduleHash,
+                               StringRef guarded)
+    : m_dir(dir.str()), m_moduleHash(moduleHash.str()),
+      m_guarded(guarded.str()) {}
+
+/**
+ * @brief Hash of the module's bitcode, a checkpoint is only valid for the
+ * exact module it was taken on
+ *
+ * @param M
+ */
+std::string WalkCheckpoint::hashModule(const Module &M) {
+    SmallVector<char, 0> bitcode;
+    raw_svector_ostream OS(bitcode);
+    WriteBitcodeToFile(M, OS);
+    SHA1 hasher;
+    hasher.update(StringRef(bitcode.data(), bitcode.size()));
+    return toHex(hasher.final(), true);
+}
+
+/**
+ * @brief Where SVF reads the points-to sets from, named after the module so
+ * a stale file is never read for another module
+ */
+std::string WalkCheckpoint::pointsToPath() const {
+    SmallString<128> path(m_dir);
+    sys::path::append(path, m_moduleHash + ".pts");
+    return path.str().str();
+}
+
+/**
+ * @brief Where SVF writes them, moved to pointsToPath by commitPointsTo once
+ * the solve is over, as SVF may be killed halfway through writing
+ */
+std::string WalkCheckpoint::pendingPointsToPath() const {
+    return pointsToPath() + ".tmp";
+}
+
+/**
+ * @brief Make the points-to sets SVF has just written the ones to resume
+ * from
+ *
+ * @return false on error, with error set
+ */
+bool WalkCheckpoint::commitPointsTo(std::string &error) const {
+    if (std::error_code E =
+            sys::fs::rename(pendingPointsToPath(), pointsToPath())) {
+        error = "Can't save " + pointsToPath() + ": " + E.message();
+        return false;
+    }
+    return true;
+}
+
+std::string WalkCheckpoint::checkpointPath() const {
+    SmallString<128> path(m_dir);
+    sys::path::append(path, "walk.checkpoint");
+    return path.str().str();
+}
+
+/**
+ * @brief Write the walk progress, through a temporary file renamed into
+ * place, so a run killed while saving leaves the previous checkpoint
+ *
+ * @return false on error, with error set
+ */
+bool WalkCheckpoint::save(const Module &M, const RelocationSet &relocations,
+                          const State &S, std::string &error) const {
+    DenseMap<const Function *, unsigned> functionIndex;
+    unsigned index = 0;
+    for (const Function &F : M) {
+        functionIndex[&F] = index++;
+    }
+
+    SmallString<128> tmpPath;
+    std::error_code E = sys::fs::create_directories(m_dir);
+    int fd = -1;
+    if (!E) {
+        E = sys::fs::createUniqueFile(checkpointPath() + ".%%%%%%.tmp", fd,
+                                      tmpPath);
+    }
+    if (E) {
+        error = "Can't create checkpoint in " + m_dir + ": " + E.message();
+        return false;
+    }
+    {
+        raw_fd_ostream OS(fd, true);
+        OS << HEADER << "\n";
+        OS << "module " << m_moduleHash << "\n";
+        OS << "guarded " << m_guarded << "\n";
+        for (const Function *F : S.visited) {
+            OS << "visited " << functionIndex[F] << "\n";
+        }
+        for (const auto &callback : S.callbacks) {
+            OS << "callback " << functionIndex[callback.first] << ","
+               << functionIndex[callback.second] << "\n";
+        }
+        // Numbered in one pass over each function holding calls
+        DenseSet<const Function *> callers;
+        DenseSet<const Instruction *> calls;
+        for (const CallInst *CI : S.calls) {
+            callers.insert(CI->getFunction());
+            calls.insert(CI);
+        }
+        for (const Function &F : M) {
+            if (!callers.count(&F)) {
+                continue;
+            }
+            unsigned instIndex = 0;
+            for (const Instruction &I : instructions(F)) {
+                if (calls.count(&I)) {
+                    OS << "call " << functionIndex[&F] << "," << instIndex
+                       << "\n";
+                }
+                ++instIndex;
+            }
+        }
+        for (const RelocationSet::Record_t &R : relocations) {
+            OS << "record " << R.first << "," << R.second << "\n";
+        }
+        for (const auto &access : relocations.accesses()) {
+            OS << "access " << access.first.first << ",";
+            if (access.first.second == RelocationSet::WHOLE_OBJECT) {
+                OS << "*";
+            } else {
+                OS << access.first.second;
+            }
+            OS << "," << RelocationSet::accessName(access.second) << "\n";
+        }
+        for (const RelocationSet::Range_t &R : relocations.ranges()) {
+            OS << "range " << R.global << "," << R.start << "," << R.stride
+               << "," << R.count << "," << R.fieldOffset << "\n";
+        }
+        OS.close();
+        if (OS.has_error()) {
+            error = "Error writing " + tmpPath.str().str() + ": " +
+                    OS.error().message();
+            OS.clear_error();
+            sys::fs::remove(tmpPath);
+            return false;
+        }
+    }
+    if ((E = sys::fs::rename(tmpPath, checkpointPath()))) {
+        error = "Can't save " + checkpointPath() + ": " + E.message();
+        sys::fs::remove(tmpPath);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Read back a checkpoint written by save on the same module, adding
+ * its records to relocations
+ *
+ * @return false if there is no usable checkpoint, with error set
+ */
+bool WalkCheckpoint::load(Module &M, RelocationSet &relocations, State &S,
+                          std::string &error) const {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> buffer =
+        MemoryBuffer::getFile(checkpointPath());
+    if (!buffer) {
+        error = "No checkpoint in " + m_dir;
+        return false;
+    }
+    std::vector<Function *> functions;
+    for (Function &F : M) {
+        functions.push_back(&F);
+    }
+    auto function = [&](StringRef field, Function *&F) {
+        unsigned index;
+        if (field.getAsInteger(10, index) || index >= functions.size()) {
+            return false;
+        }
+        F = functions[index];
+        return true;
+    };
+    // Instructions of the functions with saved calls, numbered on demand
+    DenseMap<Function *, std::vector<Instruction *>> instructionsOf;
+    auto call = [&](StringRef funcField, StringRef instField, CallInst *&CI) {
+        Function *F;
+        unsigned index;
+        if (!function(funcField, F) || instField.getAsInteger(10, index)) {
+            return false;
+        }
+        std::vector<Instruction *> &insts = instructionsOf[F];
+        if (insts.empty()) {
+            for (Instruction &I : instructions(F)) {
+                insts.push_back(&I);
+            }
+        }
+        CI = index < insts.size() ? dyn_cast<CallInst>(insts[index])
+                                  : nullptr;
+        return CI != nullptr;
+    };
+    auto global = [&](StringRef field, GlobalVariable *&G) {
+        unsigned index;
+        if (field.getAsInteger(10, index) ||
+            index >= relocations.numGlobals()) {
+            return false;
+        }
+        G = relocations.getGlobal(index);
+        return true;
+    };
+
+    SmallVector<StringRef, 0> lines;
+    (*buffer)->getBuffer().split(lines, '\n', -1, false);
+    if (lines.size() < 3 || lines[0] != HEADER ||
+        lines[1] != "module " + m_moduleHash ||
+        lines[2] != "guarded " + m_guarded) {
+        error = checkpointPath() + " is for another module or guarded function";
+        return false;
+    }
+    State loaded;
+    RelocationSet restored(M);
+    for (unsigned i = 3; i < lines.size(); ++i) {
+        StringRef kind, rest;
+        std::tie(kind, rest) = lines[i].split(' ');
+        SmallVector<StringRef, 5> fields;
+        rest.split(fields, ',');
+        bool ok = false;
+        if (kind == "visited" && fields.size() == 1) {
+            Function *F;
+            if ((ok = function(fields[0], F))) {
+                loaded.visited.push_back(F);
+            }
+        } else if (kind == "callback" && fields.size() == 2) {
+            Function *F, *registrar;
+            if ((ok = function(fields[0], F) &&
+                      function(fields[1], registrar))) {
+                loaded.callbacks.push_back(std::make_pair(F, registrar));
+            }
+        } else if (kind == "call" && fields.size() == 2) {
+            CallInst *CI;
+            if ((ok = call(fields[0], fields[1], CI))) {
+                loaded.calls.push_back(CI);
+            }
+        } else if (kind == "record" && fields.size() == 2) {
+            GlobalVariable *G;
+            unsigned offset;
+            if ((ok = global(fields[0], G) &&
+                      !fields[1].getAsInteger(10, offset))) {
+                restored.insert(G, offset);
+            }
+        } else if (kind == "access" && fields.size() == 3) {
+            GlobalVariable *G;
+            unsigned offset = RelocationSet::WHOLE_OBJECT;
+            ok = global(fields[0], G) &&
+                 (fields[1] == "*" || !fields[1].getAsInteger(10, offset));
+            for (RelocationSet::Access A :
+                 {RelocationSet::READ_ONLY, RelocationSet::WRITTEN,
+                  RelocationSet::ESCAPED}) {
+                if (ok && fields[2] == RelocationSet::accessName(A)) {
+                    restored.markAccess(G, offset, A);
+                }
+            }
+        } else if (kind == "range" && fields.size() == 5) {
+            GlobalVariable *G;
+            uint64_t values[4];
+            ok = global(fields[0], G);
+            for (unsigned f = 0; ok && f < 4; ++f) {
+                ok = !fields[f + 1].getAsInteger(10, values[f]);
+            }
+            if (ok) {
+                restored.insertRange(G, values[0], values[1], values[2],
+                                     values[3]);
+            }
+        }
+        if (!ok) {
+            error = checkpointPath() + ":" + std::to_string(i + 1) +
+                    ": malformed line";
+            return false;
+        }
+    }
+
+    // Only touch the caller's state once the whole file has been read
+    for (const RelocationSet::Record_t &R : restored) {
+        relocations.insert(restored.getGlobal(R), R.second);
+    }
+    for (const auto &access : restored.accesses()) {
+        relocations.markAccess(restored.getGlobal(access.first),
+                               access.first.second, access.second);
+    }
+    for (const RelocationSet::Range_t &R : restored.ranges()) {
+        relocations.insertRange(restored.getGlobal(R.global), R.start,
+                                R.stride, R.count, R.fieldOffset);
+    }
+    S = std::move(loaded);
+    return true;
+}
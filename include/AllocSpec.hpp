@@ -0,0 +1,69 @@
+#ifndef __ALLOC_SPEC_HPP__
+#define __ALLOC_SPEC_HPP__
+
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Module.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief Describes the allocation functions of an analyzed program. A spec
+ * file has one allocator per line, '#' starts a comment:
+ *
+ *   <function> <ret|argN> <size argument index|-> [init]
+ *
+ * "ret" means the function returns the new object, "argN" that it stores it
+ * through its Nth (pointer to pointer) argument. "init" marks wrappers that
+ * do more than allocate, e.g. store pointers into the new object or hand out
+ * recycled ones, their bodies must stay in the solve.
+ */
+class AllocSpec {
+  public:
+    static const int RETURN_VALUE = -1;
+    static const int UNKNOWN_SIZE = -1;
+
+    struct Entry {
+        int allocArg;
+        int sizeArg;
+        bool initializes;
+    };
+
+    AllocSpec();
+
+    void add(StringRef name, int allocArg, int sizeArg,
+             bool initializes = false);
+    bool loadFile(StringRef path, std::string &error);
+
+    const Entry *lookup(StringRef name) const;
+    const StringMap<Entry> &entries() const { return m_entries; }
+
+    // Names loaded from spec files, as opposed to the built-in defaults
+    const std::vector<std::string> &specified() const { return m_specified; }
+
+    void redirectForSolve(Module &M);
+    void restoreAfterSolve();
+    void release();
+    bool isSolveClone(const Function *F) const { return m_clones.count(F); }
+
+  protected:
+    StringMap<Entry> m_entries;
+    std::vector<std::string> m_specified;
+
+    MapVector<CallBase *, Function *> m_redirected;
+    std::vector<Function *> m_createdStubs;
+    // Per call site copies of the initializing wrappers, see cloneForSolve
+    SmallPtrSet<Function *, 16> m_clones;
+
+    void cloneForSolve(Function *wrapper);
+    void redirectToStub(Function *wrapper, const Entry &E);
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef __CSR_WRITER_HPP__
+#define __CSR_WRITER_HPP__
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief Writes the binary tables meant to be mmap'ed by the runtime: an
+ * 8 byte magic, then little-endian arrays, each padded to 8 bytes so every
+ * array can be used in place. Compressed sparse row layouts are built from
+ * these, a start array of rows + 1 entries indexing into a flat array.
+ */
+class CSRWriter {
+  public:
+    explicit CSRWriter(raw_ostream &OS) : m_OS(OS), m_written(0) {}
+
+    void writeMagic(StringRef magic);
+    void writeArray(ArrayRef<uint64_t> values);
+    void writeArray(ArrayRef<uint32_t> values);
+    void writeBlob(StringRef blob);
+
+    static void appendStrings(ArrayRef<std::string> strings,
+                              std::vector<uint64_t> &starts,
+                              std::string &blob);
+
+  protected:
+    void pad();
+
+    raw_ostream &m_OS;
+    uint64_t m_written;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define __COLLECT_GLOBALS_HPP__
 
 #include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SetVector.h>
 #include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/Analysis/ScalarEvolutionAliasAnalysis.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
@@ -22,13 +23,14 @@ using namespace llvm;
 
 class CollectGlobals : public ModulePass {
   protected:
-    std::unique_ptr<DenseSet<Value *>> m_globals;
+    // Kept in module order so that iterating the globals is deterministic
+    std::unique_ptr<SetVector<Value *>> m_globals;
 
   public:
     static char ID;
 
-    CollectGlobals() : ModulePass(ID), m_globals(new DenseSet<Value *>) {}
-    std::unique_ptr<DenseSet<Value *>> getResult();
+    CollectGlobals() : ModulePass(ID), m_globals(new SetVector<Value *>) {}
+    std::unique_ptr<SetVector<Value *>> getResult();
 
     bool doInitialization(Module &M) override;
     virtual bool runOnModule(Module &M) override;
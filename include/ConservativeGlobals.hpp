@@ -0,0 +1,28 @@
+#ifndef __CONSERVATIVE_GLOBALS_HPP__
+#define __CONSERVATIVE_GLOBALS_HPP__
+
+#include <llvm/ADT/SetVector.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+
+using namespace llvm;
+
+/**
+ * @brief Pointer-analysis-free over-approximation of the globals a guarded
+ * region may touch, used when the precise analysis can't be run or finished.
+ * A region reaches a global either by naming it directly, or through a
+ * pointer, which requires the global's address to be taken somewhere.
+ */
+namespace conservative {
+
+bool isAddressTaken(const Value *V);
+
+void collectAddressTakenGlobals(Module &M, const SetVector<Value *> &globals,
+                                SetVector<Value *> &result);
+
+void collectReferencedGlobals(Function &F, const SetVector<Value *> &globals,
+                              SetVector<Value *> &result);
+
+} // namespace conservative
+
+#endif
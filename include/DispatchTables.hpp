@@ -0,0 +1,70 @@
+#ifndef __DISPATCH_TABLES_HPP__
+#define __DISPATCH_TABLES_HPP__
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Operator.h>
+
+#include <functional>
+#include <utility>
+
+using namespace llvm;
+
+/**
+ * @brief Finds dispatch tables, globals whose initializers hold function (or
+ * other tables') addresses, like nginx's ngx_modules[] and command arrays or
+ * lighttpd's plugin tables, and which parts of them the program ever writes.
+ * Calls through never-written table slots are resolved from the initializers
+ * instead of the points-to sets.
+ */
+class DispatchTables {
+  public:
+    typedef std::function<bool(Value *, Value *)> AliasFn_t;
+
+    DispatchTables(Module &M, AliasFn_t mayAlias);
+
+    bool isTable(const GlobalVariable *G) const { return m_tables.count(G); }
+    bool isReadOnly(const GlobalVariable *G) const;
+    bool isReadOnly(const GlobalVariable *G, uint64_t offset,
+                    uint64_t size) const;
+
+    bool resolveCallees(Value *callee, SmallSetVector<Function *, 8> &targets);
+
+  protected:
+    // A constant found in a table's initializer, at a byte offset of it
+    struct Pointee {
+        GlobalVariable *G;
+        uint64_t offset;
+        Constant *C;
+    };
+
+    typedef SmallVector<const GlobalVariable *, 4> Tables_t;
+
+    bool holdsTargets(const Constant *C) const;
+    void findTables(Module &M);
+    void findWrites(Module &M, AliasFn_t &mayAlias);
+    void addWrite(Value *ptr, uint64_t size, AliasFn_t &mayAlias);
+    bool resolvePointees(Value *ptr, SmallVectorImpl<Pointee> &out,
+                         unsigned depth);
+    const Tables_t &pointedTables(Value *base, AliasFn_t &mayAlias);
+    bool descend(const Pointee &base, GEPOperator *GEP, unsigned idx,
+                 SmallVectorImpl<Pointee> &out);
+
+    const DataLayout &m_DL;
+    SmallPtrSet<const GlobalVariable *, 32> m_tables;
+    // Tables a pointer may hold the address of
+    Tables_t m_escapedTables;
+    // Cache of pointedTables() while the writes are collected
+    DenseMap<Value *, Tables_t> m_pointedTables;
+    // Written byte ranges of each table, and tables written at unknown
+    // offsets
+    typedef SmallVector<std::pair<uint64_t, uint64_t>, 2> Ranges_t;
+    DenseMap<const GlobalVariable *, Ranges_t> m_written;
+    SmallPtrSet<const GlobalVariable *, 8> m_wholeWritten;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef __EVENT_LOG_HPP__
+#define __EVENT_LOG_HPP__
+
+#include <ValueIds.hpp>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/Value.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief Binary trace of what the walk does, cheap enough to leave on: each
+ * event is a type, up to two values and a number, stored in a preallocated
+ * ring that keeps the most recent events. Values are numbered on first use,
+ * their names are only worked out when the log is written.
+ *
+ * Written as columns with CSRWriter, see tools/mvx-eventlog to decode:
+ *   char     magic[8]                      "MVXEVLG1"
+ *   uint64_t num_events, dropped, num_values, names_size
+ *   uint32_t type[num_events]              oldest first
+ *   uint32_t value[num_events]             0 for none
+ *   uint32_t other[num_events]             0 for none
+ *   uint64_t number[num_events]
+ *   uint64_t name_start[num_values + 1]
+ *   char     names[names_size]             stable id, or the printed value
+ *                                          when it has none
+ */
+class EventLog {
+  public:
+    enum Type {
+        VisitFunction, // function
+        VisitLoad,     // load
+        VisitCall,     // call
+        LoadAlias,     // load, global its pointer value aliases
+        GEPSet,        // number of pointers to resolve
+        GEPValue,      // pointer being resolved
+        NotConstant,   // pointer whose offset isn't constant
+        NoParent,      // base with no parent global
+        GEPParent,     // parent global, offset
+        RangeParent,   // parent global, start of the range
+        RangePastEnd,  // global
+        HeapParent,    // allocation site, offset
+        TargetGlobal,  // global relocated at offset 0
+        NUM_TYPES
+    };
+
+    struct Contents {
+        struct Event {
+            Type type;
+            uint32_t value;
+            uint32_t other;
+            uint64_t number;
+        };
+        std::vector<Event> events;
+        uint64_t dropped;
+        // Index 0 is the empty name of "no value"
+        std::vector<std::string> names;
+    };
+
+    explicit EventLog(unsigned capacity);
+
+    void record(Type T, const Value *V, const Value *other = nullptr,
+                uint64_t number = 0) {
+        Event &E = m_ring[m_recorded++ & m_mask];
+        E.type = T;
+        E.value = getIndex(V);
+        E.other = getIndex(other);
+        E.number = number;
+    }
+
+    void write(raw_ostream &OS, StableValueIds &ids) const;
+
+    static StringRef typeName(Type T);
+    static bool read(StringRef path, Contents &contents, std::string &error);
+
+  protected:
+    struct Event {
+        uint32_t type;
+        uint32_t value;
+        uint32_t other;
+        uint64_t number;
+    };
+
+    std::vector<Event> m_ring;
+    uint64_t m_mask;
+    uint64_t m_recorded;
+    DenseMap<const Value *, uint32_t> m_index;
+    std::vector<const Value *> m_values;
+
+    uint32_t getIndex(const Value *V) {
+        if (!V) {
+            return 0;
+        }
+        auto inserted = m_index.insert(std::make_pair(V, m_values.size()));
+        if (inserted.second) {
+            m_values.push_back(V);
+        }
+        return inserted.first->second;
+    }
+};
+
+#endif
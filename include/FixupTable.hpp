@@ -0,0 +1,44 @@
+#ifndef __FIXUP_TABLE_HPP__
+#define __FIXUP_TABLE_HPP__
+
+#include <RelocationSet.hpp>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief Byte offsets of the pointer slots of every relocated global, so the
+ * runtime can rebase them after moving the globals without walking debug
+ * info. Slots come from the globals' IR types, plus the offsets of the
+ * relocation records and ranges that land in untyped (i8 array, union)
+ * storage. Records on a non-pointer scalar, e.g. a global relocated whole,
+ * don't make it a slot: rebasing would corrupt an integer.
+ */
+class FixupTable {
+  public:
+    FixupTable(const RelocationSet &relocations, const DataLayout &DL);
+
+    void write(raw_ostream &OS) const;
+
+  protected:
+    const std::vector<uint64_t> &pointerSlots(Type *T);
+    bool mayHoldPointer(Type *T, uint64_t offset) const;
+
+    const RelocationSet &m_relocations;
+    const DataLayout &m_DL;
+    // Slots of each relocated global, by the global's module index
+    std::map<unsigned, std::set<uint64_t>> m_slots;
+    // Pointer slot offsets within each type seen, memoized since arrays of
+    // structs repeat them many times over
+    DenseMap<Type *, std::vector<uint64_t>> m_typeSlots;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef __GLOBAL_GRAPH_HPP__
+#define __GLOBAL_GRAPH_HPP__
+
+#include <RelocationSet.hpp>
+
+#include <llvm/ADT/SetVector.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief Which globals the pointer slots of globals may point to, starting
+ * from the relocated globals and following the slots to everything they
+ * reach. Targets come from initializers and, for slots the program loads or
+ * stores a pointer through, from alias queries on the loaded or stored
+ * values.
+ *
+ * Written as a two level CSR table, see runtime/mvx_graph.h: nodes are all
+ * the module's globals by position, each with its slots, each with its
+ * target nodes.
+ */
+class GlobalGraph {
+  public:
+    typedef std::function<bool(Value *, Value *)> AliasFn_t;
+
+    GlobalGraph(Module &M, const RelocationSet &relocations,
+                const SetVector<Value *> &targets, AliasFn_t mayAlias);
+
+    size_t numEdges() const;
+    void writeBinary(raw_ostream &OS) const;
+
+  protected:
+    typedef std::pair<unsigned, uint64_t> Slot_t;
+
+    void indexAccesses(Module &M);
+    void indexInitializer(unsigned global, Constant *C, uint64_t offset);
+    void addTargets(const Slot_t &slot, Value *V);
+
+    const RelocationSet &m_relocations;
+    const SetVector<Value *> &m_targets;
+    AliasFn_t m_mayAlias;
+    const DataLayout &m_DL;
+
+    // Values loaded from or stored to each slot, loads first
+    std::map<Slot_t, std::vector<Value *>> m_accesses;
+    // Constant pointers of initializers, by slot
+    std::map<Slot_t, Constant *> m_initial;
+    // Result, by slot
+    std::map<Slot_t, std::set<unsigned>> m_edges;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef __HEAP_SITES_HPP__
+#define __HEAP_SITES_HPP__
+
+#include <AllocSpec.hpp>
+#include <ValueIds.hpp>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief Heap allocation sites (calls to known allocators) and the offsets of
+ * their pointer-bearing fields used by the guarded region. Sites are named by
+ * the stable id of the allocating call, so a variant-aware allocator can
+ * recognize them across runs.
+ */
+class HeapSites {
+  public:
+    typedef std::pair<unsigned, unsigned> Record_t;
+
+    HeapSites(Module &M, const AllocSpec &allocators);
+
+    const std::vector<CallBase *> &getSites() const { return m_sites; }
+
+    bool insert(CallBase *site, unsigned offset);
+    size_t size() const { return m_records.size(); }
+
+    void write(raw_ostream &OS, StableValueIds &ids) const;
+
+  protected:
+    const AllocSpec &m_allocators;
+    std::vector<CallBase *> m_sites;
+    DenseMap<const CallBase *, unsigned> m_siteIndex;
+    std::set<Record_t> m_records;
+};
+
+#endif
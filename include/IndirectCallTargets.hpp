@@ -0,0 +1,59 @@
+#ifndef __INDIRECT_CALL_TARGETS_HPP__
+#define __INDIRECT_CALL_TARGETS_HPP__
+
+#include <ValueIds.hpp>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief The functions each indirect call site of the guarded region may
+ * call, so the runtime can check a call against the site's targets instead
+ * of comparing raw function addresses across variants.
+ *
+ * Sites are numbered densely in the order of their stable ids, targets are
+ * the address-taken functions whose arity fits the call and that the
+ * callee pointer may point to. Written as a CSR table, see
+ * runtime/mvx_calls.h, and each site can carry its number as !mvx.callsite
+ * metadata for the pass instrumenting the calls.
+ */
+class IndirectCallTargets {
+  public:
+    typedef std::function<bool(Value *, Function *)> MayCallFn_t;
+
+    IndirectCallTargets(Module &M, StableValueIds &ids, MayCallFn_t mayCall);
+
+    void addSite(CallInst *CI, ArrayRef<Function *> known = None);
+    std::vector<std::pair<CallInst *, ArrayRef<Function *>>> sites() const;
+    size_t numSites() const { return m_sites.size(); }
+    size_t numTargets() const;
+    void writeBinary(raw_ostream &OS) const;
+    void attachMetadata() const;
+
+    static const char *const CALLSITE_MD;
+
+  protected:
+    struct Site {
+        CallInst *call;
+        std::vector<Function *> targets;
+    };
+
+    StableValueIds &m_ids;
+    MayCallFn_t m_mayCall;
+    // Address-taken functions, by name
+    std::vector<Function *> m_candidates;
+    // By stable id, which gives the site numbering
+    std::map<std::string, Site> m_sites;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef __LIBC_SUMMARIES_HPP__
+#define __LIBC_SUMMARIES_HPP__
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Module.h>
+
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief Pointer effects of a libc/POSIX function, by argument index (-1 for
+ * none). The table is compiled in, so no libc bitcode has to be linked.
+ */
+struct LibcSummary {
+    const char *name;
+    // Memory reachable from these arguments is read / written, pointers
+    // stored in it may be copied
+    int readArg;
+    int writeArg;
+    // Function pointer argument the call invokes, and which of the call's
+    // arguments it passes on to it, by callback parameter position
+    int callbackArg;
+    int callbackData[3];
+    // Argument the call returns
+    int returnArg;
+    // SVF's own external models already cover the solve for this function
+    bool svfModeled;
+};
+
+const LibcSummary *lookupLibcSummary(StringRef name);
+
+/**
+ * @brief Lets SVF see the callbacks invoked by summarized functions it doesn't
+ * model itself, e.g. qsort's comparator or signal handlers. While solving,
+ * such calls are pointed at a generated model function that invokes the
+ * callback with the summarized arguments.
+ */
+class LibcModels {
+  public:
+    void redirectForSolve(Module &M);
+    void restoreAfterSolve();
+    void release();
+
+  protected:
+    Function *getOrCreateModel(Module &M, const LibcSummary &S,
+                               FunctionType *FT);
+
+    std::vector<std::pair<CallBase *, Value *>> m_redirected;
+    std::vector<Function *> m_models;
+    DenseMap<std::pair<const LibcSummary *, FunctionType *>, Function *>
+        m_modelsByType;
+};
+
+#endif
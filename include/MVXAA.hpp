@@ -17,11 +17,35 @@
 #include <llvm/Support/Debug.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <llvm/Transforms/Utils/CallPromotionUtils.h>
+
+// std
+#include <chrono>
+#include <map>
+#include <string>
 
 // svf
 #include <WPA/Andersen.h>
 #include <WPA/WPAPass.h>
 
+#include <AllocSpec.hpp>
+#include <ConservativeGlobals.hpp>
+#include <DispatchTables.hpp>
+#include <EventLog.hpp>
+#include <FixupTable.hpp>
+#include <GlobalGraph.hpp>
+#include <HeapSites.hpp>
+#include <IndirectCallTargets.hpp>
+#include <LibcSummaries.hpp>
+#include <ModRefSummaries.hpp>
+#include <PointerBase.hpp>
+#include <QueryTrace.hpp>
+#include <RelocationDiff.hpp>
+#include <RelocationSet.hpp>
+#include <TraversalPolicy.hpp>
+#include <ValueIds.hpp>
+#include <WalkCheckpoint.hpp>
+
 using namespace llvm;
 
 /**
@@ -31,9 +55,7 @@ using namespace llvm;
 class MVXAA : public ModulePass, public InstVisitor<MVXAA> {
 
   protected:
-    typedef std::pair<StringRef, unsigned> GlobalPair_t;
-
-    std::unique_ptr<DenseSet<Value *>> m_pglobals;
+    std::unique_ptr<SetVector<Value *>> m_pglobals;
 
     // All calls of function pointers in program
     DenseSet<CallInst *> m_fpointers;
@@ -45,14 +67,124 @@ class MVXAA : public ModulePass, public InstVisitor<MVXAA> {
     DenseSet<Value *> m_targetGlobals;
     DenseSet<Value *> m_targetGEPSet;
 
+    // Walk state: call graph nodes already visited, and functions passed as
+    // callbacks to summarized library calls, with the function that did so
+    df_iterator_default_set<CallGraphNode *> m_visitedNodes;
+    std::vector<std::pair<Function *, Function *>> m_pendingCallbacks;
+    LibcModels m_libcModels;
+
+    // Function pointer tables, calls through them are resolved from their
+    // initializers
+    std::unique_ptr<DispatchTables> m_pdispatchTables;
+
+    // Where each target was found, for reporting: the function being visited
+    // and the call path from the guarded function to it
+    Function *m_pguardedFunc;
+    Function *m_pcurrentFunc;
+    DenseMap<Value *, Function *> m_targetOrigins;
+    DenseMap<const Function *, std::string> m_callPaths;
+    DenseMap<const Function *, unsigned> m_callDepths;
+
+    // Limits on the walk, and what they kept it from visiting by function
+    // name, with the action taken and the call path that reached it first
+    TraversalPolicy m_policy;
+    std::map<std::string, std::pair<TraversalPolicy::Action, std::string>>
+        m_pruned;
+
+    // Set once the memory budget is exceeded or the deadline has passed and
+    // the SVF state has been released, the rest of the guarded region is
+    // then summarized and the result marked degraded for that reason
+    bool m_summarizing;
+    unsigned m_summarizedFuncs;
+    // Whether the globals whose address escapes have been added, which
+    // summarizing anything, degraded or by policy, requires
+    bool m_addedEscaped;
+    const char *m_degradedReason;
+
+    // -mvx-deadline, for the solve, and for the walk of each guarded region
+    // analyzed since resetWalk; and whether the solve was killed at its
+    // deadline
+    std::chrono::steady_clock::time_point m_solveDeadline;
+    std::chrono::steady_clock::time_point m_walkDeadline;
+    bool m_killedSolve;
+
+    // -mvx-checkpoint: functions walked and callbacks taken off
+    // m_pendingCallbacks so far, and what a resumed walk skips
+    std::unique_ptr<WalkCheckpoint> m_pcheckpoint;
+    bool m_resumedSolve;
+    std::chrono::steady_clock::time_point m_lastCheckpoint;
+    std::vector<Function *> m_walkedFuncs;
+    std::vector<std::pair<Function *, Function *>> m_startedCallbacks;
+    DenseSet<const Function *> m_resumedFuncs;
+
+    // Set while visiting every function for -mvx-summaries, loads then mark
+    // what they read as well
+    bool m_collectingSummaries;
+
     // For Reporting
     std::unique_ptr<raw_fd_ostream> m_pinfoFile;
-    DenseSet<GlobalPair_t> m_globalsAndOffsets;
+    std::unique_ptr<RelocationSet> m_pglobalsAndOffsets;
+
+    // Allocators of the analyzed program, and the heap allocation sites
+    // reached from the guarded region
+    AllocSpec m_allocSpec;
+    std::unique_ptr<HeapSites> m_pheapSites;
+
+    // Query tracing
+    std::unique_ptr<StableValueIds> m_pids;
+    std::unique_ptr<QueryTrace> m_ptrace;
+    std::unique_ptr<EventLog> m_pevents;
+
+    void logEvent(EventLog::Type T, const Value *V,
+                  const Value *other = nullptr, uint64_t number = 0) {
+        if (m_pevents) {
+            m_pevents->record(T, V, other, number);
+        }
+    }
+    void writeEventLog();
 
     // Helpers
     Value *aliasesGlobal(Value *V) const;
-    void dumpGlobalsToFile(DenseSet<GlobalPair_t> &globalsList);
+    Value *queryGlobalAlias(QueryTrace::Site site, Value *V);
+    void replayTrace(StringRef tracePath);
+    void dumpGlobalsToFile(const RelocationSet &globalsList);
+    void insertRange(Value *parent, const PointerBase &B, StringRef origin);
     void processPointerOperand(Value *ptrOperand);
+    void walkCallGraph(CallGraph &CG, Function *root, StringRef pathPrefix,
+                       unsigned baseDepth = 0);
+    void dumpPolicyReport();
+    void setupCheckpoint(Module &M);
+    bool walkCheckpointed() const;
+    void saveCheckpoint();
+    void resumeWalk();
+    void applyLibcSummary(CallInst &I, const LibcSummary &S);
+    void markAccess(Value *ptr, RelocationSet::Access A,
+                    bool wholeObject = false);
+    void markPointerArgs(CallInst &I, RelocationSet::Access A);
+    void markPrunedCall(CallInst &I, Function &callee);
+    StringRef getOrigin(Value *target) const;
+    void aliasesHeapSites(Value *V, SmallVectorImpl<CallBase *> &sites) const;
+    void processHeapPointerOperand(Value *ptrOperand);
+    void dumpHeapSitesToFile();
+    void exportGlobalGraph();
+    std::unique_ptr<IndirectCallTargets> collectCallTargets();
+    void exportCallTargets(const IndirectCallTargets &callTargets);
+    void promoteIndirectCalls(const IndirectCallTargets &callTargets);
+    void diffAgainstBaseline(StringRef baselinePath);
+    bool overMemoryBudget() const;
+    bool pastDeadline(std::chrono::steady_clock::time_point deadline) const;
+    bool solve(SVF::SVFModule *svfModule);
+    void startSummarizing(const char *reason);
+    void summarizeFunction(Function &F);
+    void addEscapedGlobals();
+    void queueAddressTakenFunctions(Function *guardedFunc);
+    void buildSummaries(ModRefSummaries &summaries);
+    void answerFromSummaries(Function *guardedFunc);
+    void exploreEntryPoints();
+    void collectLocalSummaries(ModRefSummaries &summaries);
+    void addSummary(const ModRefSummaries::Summary &S,
+                    RelocationSet &relocations);
+    void dumpSummariesToFile(const ModRefSummaries &summaries);
 
   public:
     static char ID;
@@ -60,8 +192,23 @@ class MVXAA : public ModulePass, public InstVisitor<MVXAA> {
 
     virtual bool runOnModule(Module &M) override;
 
+    // The steps of runOnModule, to drive the analysis without opt, see
+    // MVXSession
+    void prepare(Module &M, std::unique_ptr<SetVector<Value *>> globals);
+    void analyzeGuarded(Function *guardedFunc);
+    void resetWalk();
+    void releaseSolverState();
+    const RelocationSet &getRelocations() const {
+        return *m_pglobalsAndOffsets;
+    }
+    bool hasSolve() const { return m_pwpa != nullptr; }
+    bool isDegraded() const { return m_degradedReason != nullptr; }
+
     void visitLoadInst(LoadInst &I);
     void visitCallInst(CallInst &I);
+    void visitStoreInst(StoreInst &I);
+    void visitAtomicRMWInst(AtomicRMWInst &I);
+    void visitAtomicCmpXchgInst(AtomicCmpXchgInst &I);
 
     void resolveGEPParents(const DenseSet<Value *> &gepSet);
 
@@ -0,0 +1,58 @@
+#ifndef __MVX_SESSION_HPP__
+#define __MVX_SESSION_HPP__
+
+#include <MVXAA.hpp>
+#include <RelocationSet.hpp>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <memory>
+#include <string>
+
+using namespace llvm;
+
+/**
+ * @brief In-process use of the analysis without opt, for a long-lived
+ * process keeping modules and solves across requests:
+ *
+ *   std::string error;
+ *   auto S = MVXSession::load("merged.bc", error);
+ *   if (!S || !S->solve("fspta", error)) ...
+ *   for (StringRef func : guardedFunctions) {
+ *       const RelocationSet *R = S->analyze(func, error);
+ *       for (const RelocationSet::Record_t &record : *R) ...
+ *   }
+ *
+ * The -mvx-* options apply as for the pass, set them with
+ * cl::ParseCommandLineOptions before the first session. SVF keeps a single
+ * module per process and can't clear the backend once selected, so only one
+ * session holds a solve at a time and all of them use the same backend.
+ */
+class MVXSession {
+  public:
+    static std::unique_ptr<MVXSession> load(StringRef path,
+                                            std::string &error);
+    MVXSession(std::unique_ptr<LLVMContext> context,
+               std::unique_ptr<Module> M);
+    ~MVXSession();
+
+    Module &getModule() { return *m_pmodule; }
+    bool solve(StringRef backend, std::string &error);
+    bool isSolved() const { return m_panalysis != nullptr; }
+    bool isDegraded() const;
+    const RelocationSet *analyze(StringRef guardedFunc, std::string &error);
+    void release();
+
+  protected:
+    // Destroyed in reverse declaration order: the analysis, then the module,
+    // then its context
+    std::unique_ptr<LLVMContext> m_pcontext;
+    std::unique_ptr<Module> m_pmodule;
+    std::unique_ptr<MVXAA> m_panalysis;
+
+    static bool selectBackend(StringRef backend, std::string &error);
+};
+
+#endif
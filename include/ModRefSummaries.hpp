@@ -0,0 +1,57 @@
+#ifndef __MOD_REF_SUMMARIES_HPP__
+#define __MOD_REF_SUMMARIES_HPP__
+
+#include <RelocationSet.hpp>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Analysis/CallGraph.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief Bottom-up summaries of the globals each function touches, itself
+ * and through its callees. Local facts are filled in by the caller, one
+ * function at a time, since they come from the (single threaded) alias
+ * queries. Propagation then runs over the call graph's SCCs in parallel,
+ * each SCC starting as soon as all the SCCs it calls are done.
+ */
+class ModRefSummaries {
+  public:
+    typedef RelocationSet::Record_t Record_t;
+
+    struct Summary {
+        // Pointers loaded from globals, the records the runtime relocates
+        std::set<Record_t> records;
+        std::set<RelocationSet::Range_t> ranges;
+        // Everything read, written or escaped, at WHOLE_OBJECT if the offset
+        // isn't known
+        std::map<Record_t, RelocationSet::Access> accesses;
+        // Indirect calls reached, resolved or not
+        std::set<const CallInst *> indirectCalls;
+
+        void merge(const Summary &other);
+    };
+
+    explicit ModRefSummaries(Module &M);
+
+    Summary &getLocal(const Function *F);
+    void addCallee(Function *caller, Function *callee);
+    void propagate(unsigned threads);
+    const Summary *lookup(const Function *F) const;
+
+  protected:
+    // Private copy of the call graph, extended with the edges added by
+    // addCallee
+    CallGraph m_graph;
+    DenseMap<const Function *, Summary> m_local;
+    std::vector<Summary> m_sccSummaries;
+    DenseMap<const Function *, unsigned> m_sccOf;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __POINTER_BASE_HPP__
+#define __POINTER_BASE_HPP__
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/Value.h>
+
+#include <cstdint>
+
+using namespace llvm;
+
+/**
+ * @brief A pointer expressed as an object it points into plus a byte offset.
+ * The offset is only meaningful if exact, otherwise the pointer may be
+ * anywhere in the object.
+ *
+ * A single non-constant array index keeps the pointer exact but strided: it
+ * points to fieldOffset within one of count elements, stride bytes apart,
+ * the first starting at offset - fieldOffset. count is 0 when the index
+ * steps over a pointer rather than an array, so the bound isn't known.
+ */
+struct PointerBase {
+    Value *base;
+    int64_t offset;
+    bool exact;
+    uint64_t stride;
+    uint64_t count;
+    int64_t fieldOffset;
+
+    bool isStrided() const { return exact && stride; }
+    bool isConstant() const { return exact && !stride; }
+};
+
+void decomposePointer(Value *ptr, const DataLayout &DL,
+                      SmallVectorImpl<PointerBase> &bases);
+
+#endif
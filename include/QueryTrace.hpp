@@ -0,0 +1,49 @@
+#ifndef __QUERY_TRACE_HPP__
+#define __QUERY_TRACE_HPP__
+
+#include <ValueIds.hpp>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief Records every global alias query made by the MVX pass, one line per
+ * query:
+ *
+ *   <site> <query value id> <aliased global id or "-">
+ *
+ * The ids come from StableValueIds, so a trace recorded on one run can be
+ * read back and re-executed against the same module on a later run.
+ */
+class QueryTrace {
+  public:
+    enum Site { LoadPtr, LoadVal, CallPtr, CallArg, GEPParent };
+
+    struct Query {
+        Site site;
+        std::string valueId;
+        std::string resultId;
+    };
+
+    static StringRef siteName(Site S);
+    static bool parseSite(StringRef name, Site &S);
+
+    QueryTrace(StableValueIds &ids, std::unique_ptr<raw_fd_ostream> out);
+    ~QueryTrace();
+
+    void record(Site S, const Value *V, const Value *result);
+
+    static bool readTrace(StringRef path, std::vector<Query> &queries,
+                          std::string &error);
+
+  protected:
+    StableValueIds &m_ids;
+    std::unique_ptr<raw_fd_ostream> m_pout;
+};
+
+#endif
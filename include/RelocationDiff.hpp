@@ -0,0 +1,30 @@
+#ifndef __RELOCATION_DIFF_HPP__
+#define __RELOCATION_DIFF_HPP__
+
+#include <RelocationSet.hpp>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <set>
+#include <string>
+#include <utility>
+
+using namespace llvm;
+
+/**
+ * @brief Compares a relocation set against the dump of an earlier run, so
+ * growth of the set between releases of an analyzed program can be caught.
+ */
+class RelocationDiff {
+  public:
+    typedef std::pair<std::string, unsigned> NamedRecord_t;
+
+    bool loadBaseline(StringRef path, std::string &error);
+
+    unsigned diff(const RelocationSet &current, raw_ostream &report);
+
+  protected:
+    std::set<NamedRecord_t> m_baseline;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef __RELOCATION_SET_HPP__
+#define __RELOCATION_SET_HPP__
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief The (global, offset) pairs the MVX runtime has to relocate. Globals
+ * are interned to their position in the module so records are small
+ * integers, duplicates are dropped on insert and iteration is always in
+ * (global index, offset) order, which keeps the dump byte-stable across runs.
+ * Each record optionally remembers the guarded call path that first produced
+ * it, for reporting, and carries how the guarded region accesses it, so the
+ * runtime can share pages that are only ever read.
+ *
+ * Arrays indexed dynamically are kept as strided ranges instead: count
+ * elements, stride bytes apart from start, each with a pointer at
+ * fieldOffset.
+ *
+ * The set can also be carried in the module itself, as !mvx.relocations
+ * and !mvx.ranges named metadata plus an !mvx.relocate offset list on each
+ * relocated global, for passes running later in the same pipeline.
+ */
+class RelocationSet {
+  public:
+    typedef std::pair<unsigned, unsigned> Record_t;
+    typedef std::set<Record_t>::const_iterator const_iterator;
+
+    struct Range_t {
+        unsigned global;
+        uint64_t start;
+        uint64_t stride;
+        uint64_t count;
+        uint64_t fieldOffset;
+
+        bool operator<(const Range_t &other) const {
+            return std::tie(global, start, stride, count, fieldOffset) <
+                   std::tie(other.global, other.start, other.stride,
+                            other.count, other.fieldOffset);
+        }
+    };
+
+    // Ordered from least to most restrictive for the runtime
+    enum Access { READ_ONLY, WRITTEN, ESCAPED };
+    // Offset standing for every offset of a global
+    static const unsigned WHOLE_OBJECT = ~0u;
+
+    explicit RelocationSet(Module &M);
+
+    bool insert(Value *global, unsigned offset, StringRef origin = "");
+    StringRef getOrigin(const Record_t &R) const;
+    bool insertRange(Value *global, uint64_t start, uint64_t stride,
+                     uint64_t count, uint64_t fieldOffset,
+                     StringRef origin = "");
+    const std::set<Range_t> &ranges() const { return m_ranges; }
+    void markAccess(Value *global, unsigned offset, Access A);
+    Access getAccess(const Record_t &R) const;
+    static StringRef accessName(Access A);
+
+    unsigned numGlobals() const { return m_globals.size(); }
+    unsigned getIndex(const Value *global) const {
+        auto it = m_globalIndex.find(global);
+        assert(it != m_globalIndex.end() && "Not a global of this module!");
+        return it->second;
+    }
+    GlobalVariable *getGlobal(unsigned index) const {
+        return m_globals[index];
+    }
+    GlobalVariable *getGlobal(const Record_t &R) const {
+        return getGlobal(R.first);
+    }
+
+    const_iterator begin() const { return m_records.begin(); }
+    const_iterator end() const { return m_records.end(); }
+    size_t size() const { return m_records.size(); }
+    bool empty() const { return m_records.empty(); }
+
+    const std::map<Record_t, Access> &accesses() const { return m_access; }
+    void clear();
+
+    void write(raw_ostream &OS) const;
+    void writeRanges(raw_ostream &OS) const;
+    void attachMetadata(Module &M) const;
+    bool loadMetadata(const Module &M);
+
+    static const char *const RELOCATIONS_MD;
+    static const char *const RANGES_MD;
+    static const char *const GLOBAL_MD;
+
+  protected:
+    std::vector<GlobalVariable *> m_globals;
+    DenseMap<const Value *, unsigned> m_globalIndex;
+    std::set<Record_t> m_records;
+    std::map<Record_t, std::string> m_origins;
+    // Access found for (global, offset) or (global, WHOLE_OBJECT), which
+    // need not be records themselves
+    std::map<Record_t, Access> m_access;
+    std::set<Range_t> m_ranges;
+    std::map<Range_t, std::string> m_rangeOrigins;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef __TRAVERSAL_POLICY_HPP__
+#define __TRAVERSAL_POLICY_HPP__
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/Function.h>
+
+#include <string>
+
+using namespace llvm;
+
+/**
+ * @brief Limits on the guarded call graph walk. A policy file has one rule
+ * per line, '#' starts a comment:
+ *
+ *   opaque <function>      not visited, nor anything it calls
+ *   summarize <function>   it and everything it calls are summarized
+ *   max-depth <N>          functions deeper in the walk are not visited
+ *   budget <N>             functions over N instructions are summarized
+ *   budget <function> <N>  same, for one function
+ *
+ * A summarized function stands for the globals it names, plus every global
+ * whose address escapes, as it may reach those through pointers it is handed.
+ * Calls to an opaque (or too deep) function still mark its pointer arguments
+ * escaped and the globals it names written, without relocating them.
+ */
+class TraversalPolicy {
+  public:
+    enum Action { VISIT, OPAQUE, SUMMARIZE, OVER_BUDGET, TOO_DEEP };
+    static const unsigned NO_LIMIT = ~0u;
+
+    TraversalPolicy();
+
+    bool loadFile(StringRef path, std::string &error);
+    Action decide(const Function &F, unsigned depth) const;
+
+    static StringRef actionName(Action A);
+
+  protected:
+    StringMap<Action> m_functions;
+    StringMap<unsigned> m_budgets;
+    unsigned m_defaultBudget;
+    unsigned m_maxDepth;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef __VALUE_IDS_HPP__
+#define __VALUE_IDS_HPP__
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Value.h>
+
+#include <string>
+
+using namespace llvm;
+
+/**
+ * @brief Assigns identifiers to values that stay the same across runs on the
+ * same module, unlike pointer values or hash iteration order. Globals and
+ * functions are named "@name", arguments "func%argN" and instructions
+ * "func#N", where N is the instruction's position in the function body.
+ */
+class StableValueIds {
+  protected:
+    Module *m_pmodule;
+
+    DenseMap<const Value *, std::string> m_ids;
+    StringMap<Value *> m_values;
+    DenseSet<const Function *> m_numberedFuncs;
+
+    void numberFunction(const Function &F);
+    void numberGlobals();
+
+  public:
+    explicit StableValueIds(Module &M);
+
+    std::string getId(const Value *V);
+    Value *lookup(StringRef id);
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef __WALK_CHECKPOINT_HPP__
+#define __WALK_CHECKPOINT_HPP__
+
+#include <RelocationSet.hpp>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+/**
+ * @brief Progress of the guarded function walk saved to a directory, so a
+ * run that was killed can resume from its last checkpoint. SVF writes its
+ * points-to sets to the same directory once solved, see pointsToPath, so
+ * the solve is skipped as well. The solve itself isn't checkpointed, SVF
+ * can't save or resume its constraint graph halfway, so a run killed while
+ * solving solves again from the start.
+ *
+ * The checkpoint is a text file, globals and functions are numbered by
+ * their position in the module, instructions by their position in their
+ * function:
+ *   mvx-checkpoint 2
+ *   module <sha1 of the bitcode>
+ *   guarded <function name>
+ *   visited <function>
+ *   callback <function>,<registrar>
+ *   call <function>,<instruction>
+ *   record <global>,<offset>
+ *   access <global>,<offset or *>,<access>
+ *   range <global>,<start>,<stride>,<count>,<field offset>
+ * It is only used for the same module and guarded function, the other
+ * options are expected to match the run that wrote it.
+ */
+class WalkCheckpoint {
+  public:
+    struct State {
+        // Functions the walk visited or summarized, and every callback or
+        // table target it queued, walked yet or not
+        std::vector<Function *> visited;
+        std::vector<std::pair<Function *, Function *>> callbacks;
+        // Indirect calls found so far
+        std::vector<CallInst *> calls;
+    };
+
+    WalkCheckpoint(StringRef dir, StringRef moduleHash, StringRef guarded);
+
+    static std::string hashModule(const Module &M);
+    std::string pointsToPath() const;
+    std::string pendingPointsToPath() const;
+    bool commitPointsTo(std::string &error) const;
+    bool save(const Module &M, const RelocationSet &relocations,
+              const State &S, std::string &error) const;
+    bool load(Module &M, RelocationSet &relocations, State &S,
+              std::string &error) const;
+
+  protected:
+    std::string m_dir;
+    std::string m_moduleHash;
+    std::string m_guarded;
+
+    std::string checkpointPath() const;
+};
+
+#endif
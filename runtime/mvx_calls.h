@@ -0,0 +1,121 @@
+#ifndef __MVX_CALLS_H__
+#define __MVX_CALLS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Indirect call targets of the guarded region written by -mvx-call-targets,
+ * meant to be mmap'ed. Little-endian, every array starts 8-byte aligned:
+ *
+ *   char     magic[8]                      "MVXCALL1"
+ *   uint64_t num_sites, num_targets, num_functions, names_size
+ *   uint64_t target_start[num_sites + 1]   site -> its targets
+ *   uint32_t target[num_targets]           function indices, sorted
+ *   uint64_t name_start[num_sites + num_functions + 1]
+ *   char     names[names_size]             NUL-terminated, the stable ids
+ *                                          of the sites then the function
+ *                                          names
+ *
+ * Sites are numbered in the order of their stable ids (also attached to the
+ * calls as !mvx.callsite with -mvx-metadata), functions in name order. A
+ * site without targets is one the analysis saw no valid target for.
+ */
+
+struct mvx_calls {
+    uint64_t num_sites;
+    uint64_t num_targets;
+    uint64_t num_functions;
+    const uint64_t *target_start;
+    const uint32_t *target;
+    const uint64_t *name_start;
+    const char *names;
+};
+
+#define MVX_CALLS_ALIGN8(x) (((x) + 7) & ~(uint64_t)7)
+
+/**
+ * @brief Point c at the tables of a mapped call targets file
+ *
+ * @param map Start of the mapping, 8-byte aligned
+ * @param size Size of the mapping
+ * @param c
+ *
+ * @return 0, or -1 if it isn't a complete call targets file
+ */
+static inline int mvx_calls_open(const void *map, size_t size,
+                                 struct mvx_calls *c) {
+    const char *bytes = (const char *)map;
+    if (size < 40 || memcmp(bytes, "MVXCALL1", 8)) {
+        return -1;
+    }
+    const uint64_t *counts = (const uint64_t *)(bytes + 8);
+    c->num_sites = counts[0];
+    c->num_targets = counts[1];
+    c->num_functions = counts[2];
+    uint64_t names_size = counts[3];
+    uint64_t pos = 40;
+    uint64_t need = pos + 8 * (c->num_sites + 1) +
+                    MVX_CALLS_ALIGN8(4 * c->num_targets) +
+                    8 * (c->num_sites + c->num_functions + 1) + names_size;
+    if (need > size) {
+        return -1;
+    }
+    c->target_start = (const uint64_t *)(bytes + pos);
+    pos += 8 * (c->num_sites + 1);
+    c->target = (const uint32_t *)(bytes + pos);
+    pos += MVX_CALLS_ALIGN8(4 * c->num_targets);
+    c->name_start = (const uint64_t *)(bytes + pos);
+    pos += 8 * (c->num_sites + c->num_functions + 1);
+    c->names = bytes + pos;
+    return 0;
+}
+
+static inline const char *mvx_calls_site_id(const struct mvx_calls *c,
+                                            uint64_t site) {
+    return c->names + c->name_start[site];
+}
+
+static inline const char *mvx_calls_function_name(const struct mvx_calls *c,
+                                                  uint32_t function) {
+    return c->names + c->name_start[c->num_sites + function];
+}
+
+/**
+ * @brief May the site call the function? Binary search over the site's
+ * targets, which are few for almost every site
+ *
+ * @param c
+ * @param site
+ * @param function Index in the function table
+ *
+ * @return 1 if function is one of the site's targets
+ */
+static inline int mvx_calls_allowed(const struct mvx_calls *c, uint64_t site,
+                                    uint32_t function) {
+    uint64_t lo = c->target_start[site];
+    uint64_t hi = c->target_start[site + 1];
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (c->target[mid] == function) {
+            return 1;
+        }
+        if (c->target[mid] < function) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef __MVX_GRAPH_H__
+#define __MVX_GRAPH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Global-to-global pointer graph written by -mvx-graph, meant to be mmap'ed.
+ * Little-endian, every array starts 8-byte aligned:
+ *
+ *   char     magic[8]                      "MVXGRPH1"
+ *   uint64_t num_nodes, num_slots, num_edges, names_size
+ *   uint64_t slot_start[num_nodes + 1]     node -> its slots
+ *   uint64_t slot_offset[num_slots]        byte offset of the slot in node
+ *   uint64_t edge_start[num_slots + 1]     slot -> its targets
+ *   uint32_t edge_target[num_edges]        nodes the slot may point to
+ *   uint64_t name_start[num_nodes + 1]     node -> its name
+ *   char     names[names_size]             NUL-terminated global names
+ *
+ * Nodes are the module's globals in module order, slots of a node are sorted
+ * by offset, targets of a slot by node.
+ */
+
+struct mvx_graph {
+    uint64_t num_nodes;
+    uint64_t num_slots;
+    uint64_t num_edges;
+    const uint64_t *slot_start;
+    const uint64_t *slot_offset;
+    const uint64_t *edge_start;
+    const uint32_t *edge_target;
+    const uint64_t *name_start;
+    const char *names;
+};
+
+#define MVX_GRAPH_ALIGN8(x) (((x) + 7) & ~(uint64_t)7)
+
+/**
+ * @brief Point g at the tables of a mapped graph file
+ *
+ * @param map Start of the mapping, 8-byte aligned
+ * @param size Size of the mapping
+ * @param g
+ *
+ * @return 0, or -1 if it isn't a complete graph file
+ */
+static inline int mvx_graph_open(const void *map, size_t size,
+                                 struct mvx_graph *g) {
+    const char *bytes = (const char *)map;
+    if (size < 40 || memcmp(bytes, "MVXGRPH1", 8)) {
+        return -1;
+    }
+    const uint64_t *counts = (const uint64_t *)(bytes + 8);
+    g->num_nodes = counts[0];
+    g->num_slots = counts[1];
+    g->num_edges = counts[2];
+    uint64_t names_size = counts[3];
+    uint64_t pos = 40;
+    uint64_t need = pos + 8 * (g->num_nodes + 1) + 8 * g->num_slots +
+                    8 * (g->num_slots + 1) +
+                    MVX_GRAPH_ALIGN8(4 * g->num_edges) +
+                    8 * (g->num_nodes + 1) + names_size;
+    if (need > size) {
+        return -1;
+    }
+    g->slot_start = (const uint64_t *)(bytes + pos);
+    pos += 8 * (g->num_nodes + 1);
+    g->slot_offset = (const uint64_t *)(bytes + pos);
+    pos += 8 * g->num_slots;
+    g->edge_start = (const uint64_t *)(bytes + pos);
+    pos += 8 * (g->num_slots + 1);
+    g->edge_target = (const uint32_t *)(bytes + pos);
+    pos += MVX_GRAPH_ALIGN8(4 * g->num_edges);
+    g->name_start = (const uint64_t *)(bytes + pos);
+    pos += 8 * (g->num_nodes + 1);
+    g->names = bytes + pos;
+    return 0;
+}
+
+static inline const char *mvx_graph_name(const struct mvx_graph *g,
+                                         uint64_t node) {
+    return g->names + g->name_start[node];
+}
+
+/* Slots of node are [first_slot, end_slot), targets of slot are
+ * [first_edge, end_edge) */
+static inline uint64_t mvx_graph_first_slot(const struct mvx_graph *g,
+                                            uint64_t node) {
+    return g->slot_start[node];
+}
+
+static inline uint64_t mvx_graph_end_slot(const struct mvx_graph *g,
+                                          uint64_t node) {
+    return g->slot_start[node + 1];
+}
+
+static inline uint64_t mvx_graph_first_edge(const struct mvx_graph *g,
+                                            uint64_t slot) {
+    return g->edge_start[slot];
+}
+
+static inline uint64_t mvx_graph_end_edge(const struct mvx_graph *g,
+                                          uint64_t slot) {
+    return g->edge_start[slot + 1];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
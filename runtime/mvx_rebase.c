@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////
+// Pointer rebasing for relocated globals, see mvx_rebase.h. On x86-64 the
+// AVX-512 and AVX2 versions are compiled with target attributes, the AVX-512
+// one is picked at runtime when supported. Elsewhere only the scalar version
+// exists.
+////////////////////////////////////////////////////////////////////////////////
+#include "mvx_rebase.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MVX_REBASE_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*rebase_fn)(void *, const uint64_t *, size_t, uintptr_t,
+                          uintptr_t, intptr_t);
+
+/**
+ * @brief Rebase a single slot, slots may be unaligned in packed structs
+ */
+static inline void rebase_slot(char *slot, uintptr_t old_start,
+                               uintptr_t old_end, intptr_t delta) {
+    uintptr_t value;
+    memcpy(&value, slot, sizeof(value));
+    if (value >= old_start && value < old_end) {
+        value += delta;
+        memcpy(slot, &value, sizeof(value));
+    }
+}
+
+void mvx_rebase_scalar(void *base, const uint64_t *offsets, size_t count,
+                       uintptr_t old_start, uintptr_t old_end,
+                       intptr_t delta) {
+    char *bytes = (char *)base;
+    for (size_t i = 0; i < count; ++i) {
+        rebase_slot(bytes + offsets[i], old_start, old_end, delta);
+    }
+}
+
+#ifdef MVX_REBASE_X86
+
+/**
+ * @brief 4 slots at a time: gather, compare and add in vectors, then store
+ * back only the lanes that changed, AVX2 has no scatter
+ */
+__attribute__((target("avx2"))) void
+mvx_rebase_avx2(void *base, const uint64_t *offsets, size_t count,
+                uintptr_t old_start, uintptr_t old_end, intptr_t delta) {
+    char *bytes = (char *)base;
+    if (old_start == 0) {
+        // The lower bound below is old_start - 1
+        mvx_rebase_scalar(base, offsets, count, old_start, old_end, delta);
+        return;
+    }
+    // AVX2 only compares signed, flipping the sign bit makes it unsigned
+    const __m256i flip = _mm256_set1_epi64x((long long)1 << 63);
+    const __m256i low = _mm256_set1_epi64x((long long)(old_start - 1) ^
+                                           ((long long)1 << 63));
+    const __m256i high =
+        _mm256_set1_epi64x((long long)old_end ^ ((long long)1 << 63));
+    const __m256i add = _mm256_set1_epi64x((long long)delta);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i offs = _mm256_loadu_si256((const __m256i *)(offsets + i));
+        __m256i values =
+            _mm256_i64gather_epi64((const long long *)bytes, offs, 1);
+        __m256i biased = _mm256_xor_si256(values, flip);
+        // old_start - 1 < value < old_end
+        __m256i inside = _mm256_and_si256(_mm256_cmpgt_epi64(biased, low),
+                                          _mm256_cmpgt_epi64(high, biased));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(inside));
+        if (!mask) {
+            continue;
+        }
+        uint64_t rebased[4];
+        _mm256_storeu_si256((__m256i *)rebased,
+                            _mm256_add_epi64(values, add));
+        for (int lane = 0; lane < 4; ++lane) {
+            if (mask & (1 << lane)) {
+                memcpy(bytes + offsets[i + lane], &rebased[lane],
+                       sizeof(uint64_t));
+            }
+        }
+    }
+    mvx_rebase_scalar(base, offsets + i, count - i, old_start, old_end,
+                      delta);
+}
+
+/**
+ * @brief 8 slots at a time with masked gather/add/scatter
+ */
+__attribute__((target("avx512f"))) void
+mvx_rebase_avx512(void *base, const uint64_t *offsets, size_t count,
+                  uintptr_t old_start, uintptr_t old_end, intptr_t delta) {
+    const __m512i low = _mm512_set1_epi64((long long)old_start);
+    const __m512i high = _mm512_set1_epi64((long long)old_end);
+    const __m512i add = _mm512_set1_epi64((long long)delta);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512i offs = _mm512_loadu_si512((const void *)(offsets + i));
+        __m512i values = _mm512_i64gather_epi64(offs, base, 1);
+        __mmask8 inside = _mm512_cmpge_epu64_mask(values, low) &
+                          _mm512_cmplt_epu64_mask(values, high);
+        if (!inside) {
+            continue;
+        }
+        values = _mm512_mask_add_epi64(values, inside, values, add);
+        _mm512_mask_i64scatter_epi64(base, inside, offs, values, 1);
+    }
+    mvx_rebase_scalar(base, offsets + i, count - i, old_start, old_end,
+                      delta);
+}
+
+static rebase_fn select_impl(const char **name) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        *name = "avx512";
+        return mvx_rebase_avx512;
+    }
+    // Not AVX2: its gather and per-lane stores are slower than the scalar
+    // loop, see mvx_rebase_bench
+    *name = "scalar";
+    return mvx_rebase_scalar;
+}
+
+#else
+
+void mvx_rebase_avx2(void *base, const uint64_t *offsets, size_t count,
+                     uintptr_t old_start, uintptr_t old_end, intptr_t delta) {
+    mvx_rebase_scalar(base, offsets, count, old_start, old_end, delta);
+}
+
+void mvx_rebase_avx512(void *base, const uint64_t *offsets, size_t count,
+                       uintptr_t old_start, uintptr_t old_end,
+                       intptr_t delta) {
+    mvx_rebase_scalar(base, offsets, count, old_start, old_end, delta);
+}
+
+static rebase_fn select_impl(const char **name) {
+    *name = "scalar";
+    return mvx_rebase_scalar;
+}
+
+#endif
+
+static rebase_fn rebase_impl;
+static const char *rebase_impl_name;
+
+const char *mvx_rebase_impl(void) {
+    if (!rebase_impl) {
+        rebase_impl = select_impl(&rebase_impl_name);
+    }
+    return rebase_impl_name;
+}
+
+void mvx_rebase(void *base, const uint64_t *offsets, size_t count,
+                uintptr_t old_start, uintptr_t old_end, intptr_t delta) {
+    if (!rebase_impl) {
+        rebase_impl = select_impl(&rebase_impl_name);
+    }
+    if (old_start >= old_end) {
+        return;
+    }
+    rebase_impl(base, offsets, count, old_start, old_end, delta);
+}
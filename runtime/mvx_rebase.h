@@ -0,0 +1,50 @@
+#ifndef __MVX_REBASE_H__
+#define __MVX_REBASE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Rebase the pointer slots of one relocated global. Every slot at
+ * base + offsets[i] whose value points into [old_start, old_end) gets delta
+ * added to it, other slots are left alone.
+ *
+ * Offsets come from a global_fixups.dump line and must be distinct, as the
+ * pass writes them, since SIMD paths update several slots at once.
+ *
+ * @param base Start of the global, after it was moved
+ * @param offsets Byte offsets of its pointer slots
+ * @param count Number of offsets
+ * @param old_start Start of the region the globals were moved from
+ * @param old_end End of that region
+ * @param delta New address minus old address
+ */
+void mvx_rebase(void *base, const uint64_t *offsets, size_t count,
+                uintptr_t old_start, uintptr_t old_end, intptr_t delta);
+
+/* The individual implementations, for benchmarking. Calling one the CPU
+ * doesn't support is undefined. mvx_rebase picks the fastest supported one,
+ * scalar unless AVX-512 is available. */
+void mvx_rebase_scalar(void *base, const uint64_t *offsets, size_t count,
+                       uintptr_t old_start, uintptr_t old_end,
+                       intptr_t delta);
+void mvx_rebase_avx2(void *base, const uint64_t *offsets, size_t count,
+                     uintptr_t old_start, uintptr_t old_end, intptr_t delta);
+void mvx_rebase_avx512(void *base, const uint64_t *offsets, size_t count,
+                       uintptr_t old_start, uintptr_t old_end,
+                       intptr_t delta);
+
+/**
+ * @brief Name of the implementation mvx_rebase uses on this CPU
+ */
+const char *mvx_rebase_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks the mvx_rebase implementations on a global_fixups.dump: lays the
+// globals it lists out in an old region, points their slots into it (some
+// elsewhere, to exercise the range check), copies the region and rebases the
+// copy, checking every implementation against the scalar one.
+//
+// Usage: mvx_rebase_bench global_fixups.dump [iterations]
+////////////////////////////////////////////////////////////////////////////////
+#define _POSIX_C_SOURCE 200809L
+#include "mvx_rebase.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct fixup_global {
+    uint64_t start;
+    uint64_t *offsets;
+    size_t count;
+};
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Parse "name,size,offset,..." lines, laying the globals out one
+ * after another, 8-byte aligned
+ *
+ * @return Number of globals, or -1 on error
+ */
+static long load_fixups(const char *path, struct fixup_global **globals,
+                        uint64_t *region_size) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+    char *line = NULL;
+    size_t capacity = 0;
+    long count = 0;
+    long allocated = 0;
+    *globals = NULL;
+    *region_size = 0;
+    while (getline(&line, &capacity, file) > 0) {
+        char *fields = strchr(line, ',');
+        if (!fields) {
+            continue;
+        }
+        if (count == allocated) {
+            allocated = allocated ? allocated * 2 : 64;
+            *globals = realloc(*globals, allocated * sizeof(**globals));
+        }
+        struct fixup_global *G = &(*globals)[count++];
+        char *cursor;
+        uint64_t size = strtoull(fields + 1, &cursor, 10);
+        G->start = *region_size;
+        G->offsets = NULL;
+        G->count = 0;
+        size_t offsets_allocated = 0;
+        while (*cursor == ',') {
+            if (G->count == offsets_allocated) {
+                offsets_allocated = offsets_allocated ? offsets_allocated * 2
+                                                      : 16;
+                G->offsets = realloc(G->offsets,
+                                     offsets_allocated * sizeof(uint64_t));
+            }
+            G->offsets[G->count++] = strtoull(cursor + 1, &cursor, 10);
+        }
+        *region_size += (size + 7) & ~(uint64_t)7;
+    }
+    free(line);
+    fclose(file);
+    return count;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s global_fixups.dump [iterations]\n",
+                argv[0]);
+        return 1;
+    }
+    int iterations = argc > 2 ? atoi(argv[2]) : 1000;
+    struct fixup_global *globals;
+    uint64_t region_size;
+    long num_globals = load_fixups(argv[1], &globals, &region_size);
+    if (num_globals < 0) {
+        return 1;
+    }
+    if (region_size == 0) {
+        fprintf(stderr, "%s: no globals to rebase\n", argv[1]);
+        return 1;
+    }
+
+    char *old_region = calloc(1, region_size);
+    char *reference = malloc(region_size);
+    char *work = malloc(region_size);
+    size_t slots = 0;
+    srand(1);
+    for (long g = 0; g < num_globals; ++g) {
+        for (size_t i = 0; i < globals[g].count; ++i) {
+            // A quarter point outside the region and must be left alone
+            uintptr_t value = rand() % 4
+                                  ? (uintptr_t)old_region +
+                                        (rand() % region_size)
+                                  : (uintptr_t)(rand() % 2 ? 0 : 0x1000);
+            memcpy(old_region + globals[g].start + globals[g].offsets[i],
+                   &value, sizeof(value));
+        }
+        slots += globals[g].count;
+    }
+
+    uintptr_t old_start = (uintptr_t)old_region;
+    uintptr_t old_end = old_start + region_size;
+    static const struct {
+        const char *name;
+        void (*fn)(void *, const uint64_t *, size_t, uintptr_t, uintptr_t,
+                   intptr_t);
+    } impls[] = {{"scalar", mvx_rebase_scalar},
+                 {"avx2", mvx_rebase_avx2},
+                 {"avx512", mvx_rebase_avx512}};
+
+    printf("%ld globals, %zu slots, %llu bytes, dispatch picks %s\n",
+           num_globals, slots, (unsigned long long)region_size,
+           mvx_rebase_impl());
+    int failed = 0;
+    for (unsigned k = 0; k < sizeof(impls) / sizeof(impls[0]); ++k) {
+        if ((k == 1 && !__builtin_cpu_supports("avx2")) ||
+            (k == 2 && !__builtin_cpu_supports("avx512f"))) {
+            printf("%-8s unsupported\n", impls[k].name);
+            continue;
+        }
+        intptr_t delta = (intptr_t)work - (intptr_t)old_region;
+        double total = 0;
+        for (int it = 0; it < iterations; ++it) {
+            memcpy(work, old_region, region_size);
+            double start = now_ns();
+            for (long g = 0; g < num_globals; ++g) {
+                impls[k].fn(work + globals[g].start, globals[g].offsets,
+                            globals[g].count, old_start, old_end, delta);
+            }
+            total += now_ns() - start;
+        }
+        if (k == 0) {
+            memcpy(reference, work, region_size);
+        } else if (memcmp(reference, work, region_size)) {
+            printf("%-8s MISMATCH against scalar\n", impls[k].name);
+            failed = 1;
+            continue;
+        }
+        printf("%-8s %10.1f us/rebase %6.2f ns/slot\n", impls[k].name,
+               total / iterations / 1e3,
+               slots ? total / iterations / slots : 0.0);
+    }
+    return failed;
+}
@@ -0,0 +1,138 @@
+#ifndef __MVX_RELOCS_H__
+#define __MVX_RELOCS_H__
+
+#include <elf.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Address table added to a linked binary by tools/mvx-resolve, in its
+ * .mvx_relocs section. Little-endian, every array starts 8-byte aligned:
+ *
+ *   char     magic[8]                      "MVXRELT1"
+ *   uint64_t num_sections, num_entries, names_size
+ *   uint64_t section_addr[num_sections]    link-time address of the section
+ *   uint64_t name_start[num_sections + 1]  section -> its name
+ *   char     names[names_size]             NUL-terminated section names
+ *   uint64_t offset[num_entries]           byte offset in the section
+ *   uint32_t section[num_entries]          section the entry is in
+ *   uint32_t access[num_entries]           MVX_RELOC_* below
+ *
+ * Entries are sorted by section then offset, the runtime address of entry i
+ * is load_bias + section_addr[section[i]] + offset[i].
+ */
+
+enum { MVX_RELOC_READ_ONLY = 0, MVX_RELOC_WRITTEN = 1, MVX_RELOC_ESCAPED = 2 };
+
+struct mvx_relocs {
+    uint64_t num_sections;
+    uint64_t num_entries;
+    const uint64_t *section_addr;
+    const uint64_t *name_start;
+    const char *names;
+    const uint64_t *offset;
+    const uint32_t *section;
+    const uint32_t *access;
+};
+
+#define MVX_RELOCS_ALIGN8(x) (((x) + 7) & ~(uint64_t)7)
+
+/**
+ * @brief Point r at the arrays of a table
+ *
+ * @param map Start of the table, 8-byte aligned
+ * @param size Size of the table
+ * @param r
+ *
+ * @return 0, or -1 if it isn't a complete table
+ */
+static inline int mvx_relocs_open(const void *map, size_t size,
+                                  struct mvx_relocs *r) {
+    const char *bytes = (const char *)map;
+    if (size < 32 || memcmp(bytes, "MVXRELT1", 8)) {
+        return -1;
+    }
+    const uint64_t *counts = (const uint64_t *)(bytes + 8);
+    r->num_sections = counts[0];
+    r->num_entries = counts[1];
+    uint64_t names_size = counts[2];
+    uint64_t pos = 32;
+    uint64_t need = pos + 8 * r->num_sections + 8 * (r->num_sections + 1) +
+                    MVX_RELOCS_ALIGN8(names_size) + 8 * r->num_entries +
+                    MVX_RELOCS_ALIGN8(4 * r->num_entries) + 4 * r->num_entries;
+    if (need > size) {
+        return -1;
+    }
+    r->section_addr = (const uint64_t *)(bytes + pos);
+    pos += 8 * r->num_sections;
+    r->name_start = (const uint64_t *)(bytes + pos);
+    pos += 8 * (r->num_sections + 1);
+    r->names = bytes + pos;
+    pos += MVX_RELOCS_ALIGN8(names_size);
+    r->offset = (const uint64_t *)(bytes + pos);
+    pos += 8 * r->num_entries;
+    r->section = (const uint32_t *)(bytes + pos);
+    pos += MVX_RELOCS_ALIGN8(4 * r->num_entries);
+    r->access = (const uint32_t *)(bytes + pos);
+    return 0;
+}
+
+static inline const char *mvx_relocs_section_name(const struct mvx_relocs *r,
+                                                  uint64_t section) {
+    return r->names + r->name_start[section];
+}
+
+static inline uint64_t mvx_relocs_address(const struct mvx_relocs *r,
+                                          uint64_t entry, uint64_t load_bias) {
+    return load_bias + r->section_addr[r->section[entry]] + r->offset[entry];
+}
+
+/**
+ * @brief Find the .mvx_relocs section of a mapped 64-bit ELF file, the
+ * section isn't loaded with the program so the loader maps the executable
+ *
+ * @param elf Start of the mapped file
+ * @param size Size of the mapping
+ * @param table_size Set to the size of the table
+ *
+ * @return Start of the table, or NULL if the file has none
+ */
+static inline const void *mvx_relocs_find(const void *elf, size_t size,
+                                          size_t *table_size) {
+    const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)elf;
+    if (size < sizeof(*ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) ||
+        ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+        ehdr->e_shoff + (uint64_t)ehdr->e_shnum * sizeof(Elf64_Shdr) > size ||
+        ehdr->e_shstrndx >= ehdr->e_shnum) {
+        return NULL;
+    }
+    const Elf64_Shdr *shdrs =
+        (const Elf64_Shdr *)((const char *)elf + ehdr->e_shoff);
+    const Elf64_Shdr *strtab = &shdrs[ehdr->e_shstrndx];
+    for (uint16_t i = 0; i < ehdr->e_shnum; ++i) {
+        if (shdrs[i].sh_name >= strtab->sh_size ||
+            strtab->sh_offset + strtab->sh_size > size) {
+            continue;
+        }
+        const char *name =
+            (const char *)elf + strtab->sh_offset + shdrs[i].sh_name;
+        if (strncmp(name, ".mvx_relocs", strtab->sh_size - shdrs[i].sh_name) ||
+            shdrs[i].sh_offset + shdrs[i].sh_size > size) {
+            continue;
+        }
+        *table_size = shdrs[i].sh_size;
+        return (const char *)elf + shdrs[i].sh_offset;
+    }
+    return NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
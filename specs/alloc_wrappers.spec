@@ -0,0 +1,32 @@
+# Allocation wrappers of the test corpora, for -mvx-alloc-spec
+# <function> <ret|argN> <size argument index|-> [init]
+# Pure allocators are solved as malloc. Wrappers marked init store into
+# what they return, or recycle objects, and are cloned per call site.
+
+# nginx
+ngx_alloc               ret 0
+ngx_calloc              ret 0
+ngx_palloc              ret 1
+ngx_pnalloc             ret 1
+ngx_pcalloc             ret 1
+ngx_pmemalign           ret 1
+ngx_create_pool         ret 0 init
+ngx_create_temp_buf     ret - init
+ngx_alloc_chain_link    ret - init
+ngx_array_create        ret - init
+ngx_list_create         ret - init
+
+# lighttpd
+buffer_init             ret -
+buffer_init_buffer      ret - init
+buffer_init_string      ret - init
+array_init              ret - init
+chunkqueue_init         ret - init
+data_string_init        ret - init
+
+# openssh
+xmalloc                 ret 0
+xcalloc                 ret -
+xreallocarray           ret -
+xrecallocarray          ret -
+xstrdup                 ret -
@@ -0,0 +1,370 @@
+////////////////////////////////////////////////////////////////////////////////
+// mvx-bcpipe: builds an analysis-ready (mem2reg'd, linked) module from C
+// sources. Replaces the serial clang + opt -mem2reg + llvm-link steps of the
+// test corpora with:
+//   - per-TU compiles running in parallel,
+//   - mem2reg applied in-process on the freshly compiled bitcode,
+//   - per-TU outputs cached by a hash of the preprocessed source and flags,
+//   - a tree-shaped link where each level merges pairs in parallel.
+//
+// Usage: mvx-bcpipe -o merged.bc [-j N] [-cache-dir DIR] a.c b.c -- <cflags>
+////////////////////////////////////////////////////////////////////////////////
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FileUtilities.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/WithColor.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Mem2Reg.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static cl::list<std::string> Sources(cl::Positional, cl::OneOrMore,
+                                     cl::desc("<C sources>"));
+
+static cl::opt<std::string> Output("o", cl::Required,
+                                   cl::desc("Merged bitcode output"),
+                                   cl::value_desc("filename"));
+
+static cl::opt<unsigned> Jobs("j", cl::desc("Number of parallel jobs"),
+                              cl::init(0));
+
+static cl::opt<std::string>
+    CacheDir("cache-dir", cl::desc("Directory for cached per-TU bitcode"),
+             cl::init(".mvx-bccache"), cl::value_desc("directory"));
+
+static cl::opt<std::string> Compiler("cc", cl::desc("C compiler to run"),
+                                     cl::init("clang"));
+
+static std::mutex ErrorLock;
+static bool HadError = false;
+
+static void reportError(const Twine &msg) {
+    std::lock_guard<std::mutex> guard(ErrorLock);
+    WithColor::error(errs(), "mvx-bcpipe") << msg << "\n";
+    HadError = true;
+}
+
+/**
+ * @brief Run the compiler, output is discarded unless it fails
+ *
+ * @param args Arguments after the program name
+ *
+ * @return false if it couldn't be run or exited with an error
+ */
+static bool runCompiler(StringRef compilerPath, ArrayRef<std::string> args) {
+    std::vector<StringRef> argv{compilerPath};
+    for (const std::string &arg : args) {
+        argv.push_back(arg);
+    }
+    std::string errMsg;
+    int rc = sys::ExecuteAndWait(compilerPath, argv, None, {}, 0, 0, &errMsg);
+    if (rc != 0) {
+        reportError(Twine(compilerPath) + " failed on " + args.back() +
+                    (errMsg.empty() ? "" : ": " + errMsg));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Identify the compiler by its resolved path and --version output, so
+ * switching compilers or upgrading one doesn't reuse stale cached bitcode
+ *
+ * @param compilerPath
+ * @param identity Set to the path and version text
+ *
+ * @return false on failure, already reported
+ */
+static bool identifyCompiler(StringRef compilerPath, std::string &identity) {
+    SmallString<128> versionFile;
+    if (std::error_code E =
+            sys::fs::createTemporaryFile("mvx-bcpipe", "txt", versionFile)) {
+        reportError("can't create temporary file: " + E.message());
+        return false;
+    }
+    FileRemover removeVersion(versionFile);
+
+    StringRef argv[] = {compilerPath, "--version"};
+    Optional<StringRef> redirects[] = {None, StringRef(versionFile), None};
+    std::string errMsg;
+    if (sys::ExecuteAndWait(compilerPath, argv, None, redirects, 0, 0,
+                            &errMsg) != 0) {
+        reportError(Twine(compilerPath) + " --version failed" +
+                    (errMsg.empty() ? "" : ": " + errMsg));
+        return false;
+    }
+    ErrorOr<std::unique_ptr<MemoryBuffer>> version =
+        MemoryBuffer::getFile(versionFile);
+    if (!version) {
+        reportError("can't read the version of " + compilerPath);
+        return false;
+    }
+    identity = compilerPath.str() + '\0' + (*version)->getBuffer().str();
+    return true;
+}
+
+/**
+ * @brief mem2reg every function of a module in-process, so we don't spawn an
+ * opt for each TU
+ *
+ * @param M
+ */
+static void promoteMemoryToRegisters(Module &M) {
+    PassBuilder PB;
+    FunctionAnalysisManager FAM;
+    PB.registerFunctionAnalyses(FAM);
+    FunctionPassManager FPM;
+    FPM.addPass(PromotePass());
+    for (Function &F : M) {
+        if (!F.isDeclaration()) {
+            FPM.run(F, FAM);
+        }
+    }
+}
+
+/**
+ * @brief Preprocess, then compile and mem2reg a single TU unless the cache
+ * already has bitcode for the same preprocessed source and flags
+ *
+ * @param compilerId Compiler identity from identifyCompiler
+ * @param source
+ * @param cflags
+ * @param bcPath Set to the cached bitcode for the TU
+ *
+ * @return false on failure, already reported
+ */
+static bool buildTU(StringRef compilerPath, StringRef compilerId,
+                    StringRef source, ArrayRef<std::string> cflags,
+                    std::string &bcPath) {
+    SmallString<128> preprocessed;
+    if (std::error_code E =
+            sys::fs::createTemporaryFile("mvx-bcpipe", "i", preprocessed)) {
+        reportError("can't create temporary file: " + E.message());
+        return false;
+    }
+    FileRemover removePreprocessed(preprocessed);
+
+    std::vector<std::string> args(cflags.begin(), cflags.end());
+    args.insert(args.end(),
+                {"-E", "-o", preprocessed.str().str(), source.str()});
+    if (!runCompiler(compilerPath, args)) {
+        return false;
+    }
+
+    ErrorOr<std::unique_ptr<MemoryBuffer>> text =
+        MemoryBuffer::getFile(preprocessed);
+    if (!text) {
+        reportError("can't read preprocessed " + source + ": " +
+                    text.getError().message());
+        return false;
+    }
+
+    // Key on everything that affects codegen: compiler, flags and
+    // preprocessed source
+    SHA1 hasher;
+    hasher.update(compilerId);
+    hasher.update(StringRef("\0", 1));
+    for (const std::string &flag : cflags) {
+        hasher.update(flag);
+        hasher.update(StringRef("\0", 1));
+    }
+    hasher.update((*text)->getBuffer());
+    SmallString<128> cached(CacheDir);
+    sys::path::append(cached, toHex(hasher.final(), true) + ".bc");
+    bcPath = cached.str().str();
+    if (sys::fs::exists(bcPath)) {
+        return true;
+    }
+
+    // Compile the preprocessed file directly, no need to preprocess twice
+    SmallString<128> compiled;
+    if (std::error_code E = sys::fs::createUniqueFile(bcPath + ".%%%%%%.tmp",
+                                                      compiled)) {
+        reportError("can't create " + bcPath + ": " + E.message());
+        return false;
+    }
+    FileRemover removeCompiled(compiled);
+    args.assign(cflags.begin(), cflags.end());
+    args.insert(args.end(), {"-c", "-emit-llvm", "-x", "cpp-output", "-o",
+                             compiled.str().str(),
+                             preprocessed.str().str()});
+    if (!runCompiler(compilerPath, args)) {
+        return false;
+    }
+
+    LLVMContext context;
+    ErrorOr<std::unique_ptr<MemoryBuffer>> bc = MemoryBuffer::getFile(compiled);
+    if (!bc) {
+        reportError("can't read bitcode of " + source);
+        return false;
+    }
+    Expected<std::unique_ptr<Module>> M =
+        parseBitcodeFile((*bc)->getMemBufferRef(), context);
+    if (!M) {
+        reportError("bad bitcode for " + source + ": " +
+                    toString(M.takeError()));
+        return false;
+    }
+    // Name the module after the real source rather than the temporary file
+    (*M)->setSourceFileName(source);
+    (*M)->setModuleIdentifier(source);
+    promoteMemoryToRegisters(**M);
+    bc->reset();
+
+    // Overwrite the compiler's output and move it into place, so a concurrent
+    // or interrupted run never sees a partial cache entry
+    std::error_code E;
+    {
+        raw_fd_ostream out(compiled, E);
+        if (!E) {
+            WriteBitcodeToFile(**M, out);
+        }
+    }
+    if (!E) {
+        E = sys::fs::rename(compiled, bcPath);
+    }
+    if (E) {
+        reportError("can't write " + bcPath + ": " + E.message());
+        return false;
+    }
+    removeCompiled.releaseFile();
+    return true;
+}
+
+/**
+ * @brief Link two bitcode buffers in a private context and return the result
+ * as bitcode, so merges at the same tree level can run in parallel
+ *
+ * @param left
+ * @param right
+ * @param merged
+ *
+ * @return false on failure, already reported
+ */
+static bool linkPair(const SmallVector<char, 0> &left,
+                     const SmallVector<char, 0> &right,
+                     SmallVector<char, 0> &merged) {
+    LLVMContext context;
+    auto parse = [&](const SmallVector<char, 0> &buf) {
+        return parseBitcodeFile(
+            MemoryBufferRef(StringRef(buf.data(), buf.size()), "<merge>"),
+            context);
+    };
+    Expected<std::unique_ptr<Module>> dest = parse(left);
+    if (!dest) {
+        reportError("bad intermediate bitcode: " + toString(dest.takeError()));
+        return false;
+    }
+    Expected<std::unique_ptr<Module>> src = parse(right);
+    if (!src) {
+        reportError("bad intermediate bitcode: " + toString(src.takeError()));
+        return false;
+    }
+    if (Linker::linkModules(**dest, std::move(*src))) {
+        reportError("link failed");
+        return false;
+    }
+    raw_svector_ostream out(merged);
+    WriteBitcodeToFile(**dest, out);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    // Everything after "--" goes to the compiler untouched
+    std::vector<const char *> toolArgs;
+    std::vector<std::string> cflags;
+    bool seenSeparator = false;
+    for (int i = 0; i < argc; ++i) {
+        if (seenSeparator) {
+            cflags.push_back(argv[i]);
+        } else if (StringRef(argv[i]) == "--") {
+            seenSeparator = true;
+        } else {
+            toolArgs.push_back(argv[i]);
+        }
+    }
+    cl::ParseCommandLineOptions(toolArgs.size(), toolArgs.data(),
+                                "Parallel bitcode build for MVX analysis\n");
+
+    ErrorOr<std::string> compilerPath = sys::findProgramByName(Compiler);
+    if (!compilerPath) {
+        reportError("can't find " + Compiler);
+        return 1;
+    }
+    std::string compilerId;
+    if (!identifyCompiler(*compilerPath, compilerId)) {
+        return 1;
+    }
+    if (std::error_code E = sys::fs::create_directories(CacheDir)) {
+        reportError("can't create " + CacheDir + ": " + E.message());
+        return 1;
+    }
+
+    ThreadPool pool(hardware_concurrency(Jobs));
+
+    std::vector<std::string> tuBitcode(Sources.size());
+    for (unsigned i = 0; i < Sources.size(); ++i) {
+        pool.async([&, i] {
+            buildTU(*compilerPath, compilerId, Sources[i], cflags,
+                    tuBitcode[i]);
+        });
+    }
+    pool.wait();
+    if (HadError) {
+        return 1;
+    }
+
+    std::vector<SmallVector<char, 0>> level(tuBitcode.size());
+    for (unsigned i = 0; i < tuBitcode.size(); ++i) {
+        ErrorOr<std::unique_ptr<MemoryBuffer>> bc =
+            MemoryBuffer::getFile(tuBitcode[i]);
+        if (!bc) {
+            reportError("can't read " + tuBitcode[i]);
+            return 1;
+        }
+        level[i].append((*bc)->getBufferStart(), (*bc)->getBufferEnd());
+    }
+
+    // Merge neighbours pairwise until a single module is left, an odd one
+    // out is carried to the next level as is
+    while (level.size() > 1) {
+        std::vector<SmallVector<char, 0>> next((level.size() + 1) / 2);
+        for (unsigned i = 0; i + 1 < level.size(); i += 2) {
+            pool.async([&, i] { linkPair(level[i], level[i + 1], next[i / 2]); });
+        }
+        if (level.size() % 2) {
+            next.back() = std::move(level.back());
+        }
+        pool.wait();
+        if (HadError) {
+            return 1;
+        }
+        level = std::move(next);
+    }
+
+    std::error_code E;
+    raw_fd_ostream out(Output, E, sys::fs::OF_None);
+    if (E) {
+        reportError("can't write " + Output + ": " + E.message());
+        return 1;
+    }
+    out.write(level.front().data(), level.front().size());
+    return 0;
+}
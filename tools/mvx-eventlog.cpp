@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////
+// mvx-eventlog: pretty-prints an -mvx-event-log, one event per line, oldest
+// first. Values are shown by their stable id, or as IR with -module, which
+// must be the module the pass ran on.
+//
+// Usage: mvx-eventlog [-module merged.bc] [-type gep-parent] events.bin
+////////////////////////////////////////////////////////////////////////////////
+#include <EventLog.hpp>
+#include <ValueIds.hpp>
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/WithColor.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <memory>
+#include <string>
+
+using namespace llvm;
+
+static cl::opt<std::string> LogFile(cl::Positional, cl::Required,
+                                    cl::desc("<event log>"));
+
+static cl::opt<std::string>
+    ModuleFile("module", cl::desc("Module the log was recorded on, to print "
+                                  "values as IR"),
+               cl::value_desc("filename"));
+
+static cl::list<std::string>
+    Types("type", cl::desc("Only print events of this type, can be repeated"),
+          cl::value_desc("event type"));
+
+/**
+ * @brief Print a value of the log, as IR when it can be found in the module
+ *
+ * @param name Stable id, or the value as printed by the pass
+ * @param ids Null without -module
+ */
+static void printValue(raw_ostream &OS, const std::string &name,
+                       StableValueIds *ids) {
+    if (Value *V = ids ? ids->lookup(name) : nullptr) {
+        if (isa<Instruction>(V)) {
+            std::string text;
+            raw_string_ostream printed(text);
+            printed << *V;
+            OS << StringRef(printed.str()).ltrim();
+        } else {
+            V->printAsOperand(OS, false);
+        }
+        return;
+    }
+    OS << name;
+}
+
+int main(int argc, char **argv) {
+    cl::ParseCommandLineOptions(argc, argv, "Decode an MVX event log\n");
+
+    EventLog::Contents contents;
+    std::string error;
+    if (!EventLog::read(LogFile, contents, error)) {
+        WithColor::error(errs(), "mvx-eventlog") << error << "\n";
+        return 1;
+    }
+
+    LLVMContext context;
+    std::unique_ptr<Module> M;
+    std::unique_ptr<StableValueIds> ids;
+    if (!ModuleFile.empty()) {
+        SMDiagnostic diag;
+        M = parseIRFile(ModuleFile, diag, context);
+        if (!M) {
+            diag.print("mvx-eventlog", errs());
+            return 1;
+        }
+        ids = std::make_unique<StableValueIds>(*M);
+    }
+
+    bool shown[EventLog::NUM_TYPES];
+    for (unsigned T = 0; T < EventLog::NUM_TYPES; ++T) {
+        shown[T] = Types.empty();
+    }
+    for (const std::string &type : Types) {
+        bool known = false;
+        for (unsigned T = 0; T < EventLog::NUM_TYPES; ++T) {
+            if (EventLog::typeName((EventLog::Type)T) == type) {
+                shown[T] = known = true;
+            }
+        }
+        if (!known) {
+            WithColor::error(errs(), "mvx-eventlog")
+                << "unknown event type " << type << "\n";
+            return 1;
+        }
+    }
+
+    if (contents.dropped) {
+        outs() << "# " << contents.dropped
+               << " older events dropped, raise -mvx-event-log-size\n";
+    }
+    for (size_t i = 0; i < contents.events.size(); ++i) {
+        const EventLog::Contents::Event &E = contents.events[i];
+        if (!shown[E.type]) {
+            continue;
+        }
+        outs() << contents.dropped + i << " " << EventLog::typeName(E.type);
+        if (E.value) {
+            outs() << " ";
+            printValue(outs(), contents.names[E.value], ids.get());
+        }
+        if (E.other) {
+            outs() << " -> ";
+            printValue(outs(), contents.names[E.other], ids.get());
+        }
+        if (E.number || E.type == EventLog::GEPParent ||
+            E.type == EventLog::RangeParent ||
+            E.type == EventLog::HeapParent) {
+            outs() << " " << E.number;
+        }
+        outs() << "\n";
+    }
+    return 0;
+}
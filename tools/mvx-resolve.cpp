@@ -0,0 +1,439 @@
+////////////////////////////////////////////////////////////////////////////////
+// mvx-resolve: turns global_addresses.dump into an address table embedded in
+// the linked binary, so the MVX loader doesn't resolve names at startup.
+// Each (global, offset) record becomes (section, offset in section), using
+// the ELF symbol table, and the table is added to the binary as a read-only
+// .mvx_relocs section with llvm-objcopy. Layout in runtime/mvx_relocs.h.
+//
+// Strided ranges from global_ranges.dump, given with -ranges, are expanded
+// into one entry per element.
+//
+// Run it on the linked binary before stripping it, it needs the static symbol
+// table, and stripping keeps the section. It isn't part of a loadable
+// segment, the loader maps it from the executable file (see mvx_relocs_find
+// in runtime/mvx_relocs.h).
+//
+// Usage: mvx-resolve [-o out] [-table-only] [-ranges global_ranges.dump]
+//                    global_addresses.dump binary
+////////////////////////////////////////////////////////////////////////////////
+#include <CSRWriter.hpp>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Object/ELFObjectFile.h>
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FileUtilities.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/WithColor.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::object;
+
+static cl::opt<std::string> DumpPath(cl::Positional, cl::Required,
+                                     cl::desc("<global_addresses.dump>"));
+
+static cl::opt<std::string> BinaryPath(cl::Positional, cl::Required,
+                                       cl::desc("<linked ELF binary>"));
+
+static cl::opt<std::string>
+    Output("o", cl::desc("Binary to write, the input is updated if not set"),
+           cl::value_desc("filename"));
+
+static cl::opt<bool>
+    TableOnly("table-only",
+              cl::desc("Write the table to -o instead of adding it to the "
+                       "binary"),
+              cl::init(false));
+
+static cl::opt<std::string>
+    RangesPath("ranges", cl::desc("Strided ranges to add, one entry each"),
+               cl::value_desc("global_ranges.dump"));
+
+static cl::opt<bool> AllowMissing(
+    "allow-missing",
+    cl::desc("Skip records whose global isn't in the symbol table, or is "
+             "ambiguous: several local symbols of that name"),
+    cl::init(false));
+
+static cl::opt<std::string> Objcopy("objcopy",
+                                    cl::desc("objcopy to add the section"),
+                                    cl::init("llvm-objcopy"));
+
+static const char *const SECTION_NAME = ".mvx_relocs";
+
+// Same order as the dump's access column, unknown counts as written
+enum Access { READ_ONLY, WRITTEN, ESCAPED };
+
+struct Entry {
+    uint32_t section;
+    uint64_t offset;
+    uint32_t access;
+
+    bool operator<(const Entry &other) const {
+        return std::tie(section, offset) <
+               std::tie(other.section, other.offset);
+    }
+};
+
+struct SymbolLocation {
+    uint64_t sectionIndex;
+    uint64_t sectionOffset;
+    // Several symbols of this name are at different places, e.g. statics of
+    // the same name in different objects
+    bool ambiguous;
+};
+
+static bool reportError(const Twine &msg) {
+    WithColor::error(errs(), "mvx-resolve") << msg << "\n";
+    return false;
+}
+
+/**
+ * @brief Index the defined data symbols of the binary by name, from the
+ * static symbol table. The dynamic one is no substitute, an executable's
+ * globals are rarely exported.
+ *
+ * @param Obj
+ * @param symbols
+ * @param sections Address and name of each section, by section index
+ */
+static void
+indexSymbols(const ELFObjectFileBase &Obj, StringMap<SymbolLocation> &symbols,
+             DenseMap<uint64_t, std::pair<uint64_t, std::string>> &sections) {
+    for (const SectionRef &section : Obj.sections()) {
+        Expected<StringRef> name = section.getName();
+        sections[section.getIndex()] = std::make_pair(
+            section.getAddress(), name ? name->str() : std::string());
+        if (!name) {
+            consumeError(name.takeError());
+        }
+    }
+    auto add = [&](const SymbolRef &sym) {
+        Expected<SymbolRef::Type> type = sym.getType();
+        Expected<StringRef> name = sym.getName();
+        Expected<uint64_t> address = sym.getAddress();
+        Expected<section_iterator> section = sym.getSection();
+        if (!type || !name || !address || !section ||
+            *section == Obj.section_end() || *type == SymbolRef::ST_Function) {
+            consumeError(type.takeError());
+            consumeError(name.takeError());
+            consumeError(address.takeError());
+            consumeError(section.takeError());
+            return;
+        }
+        SymbolLocation loc = {(*section)->getIndex(),
+                              *address - (*section)->getAddress(), false};
+        auto inserted = symbols.insert(std::make_pair(*name, loc));
+        SymbolLocation &known = inserted.first->second;
+        if (!inserted.second && (known.sectionIndex != loc.sectionIndex ||
+                                 known.sectionOffset != loc.sectionOffset)) {
+            known.ambiguous = true;
+        }
+    };
+    for (const SymbolRef &sym : Obj.symbols()) {
+        add(sym);
+    }
+}
+
+/**
+ * @brief Find the symbol of a global named by a dump, reporting it if missing
+ * or ambiguous, unless -allow-missing
+ *
+ * @param ok Cleared on a reported error
+ *
+ * @return nullptr if the global can't be resolved
+ */
+static const SymbolLocation *
+lookupSymbol(StringRef name, const StringMap<SymbolLocation> &symbols,
+             bool &ok) {
+    auto it = symbols.find(name);
+    if (it != symbols.end() && !it->second.ambiguous) {
+        return &it->second;
+    }
+    if (!AllowMissing) {
+        reportError(it == symbols.end()
+                        ? "no symbol for " + name
+                        : "several symbols named " + name +
+                              ", can't tell which one is relocated");
+        ok = false;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Resolve every "name,offset[,access]" record of the dump
+ *
+ * @return false on failure, already reported
+ */
+static bool resolveRecords(StringRef dump,
+                           const StringMap<SymbolLocation> &symbols,
+                           std::vector<std::pair<uint64_t, Entry>> &resolved) {
+    SmallVector<StringRef, 0> lines;
+    dump.split(lines, '\n', -1, false);
+    bool ok = true;
+    for (unsigned i = 0; i < lines.size(); ++i) {
+        StringRef line = lines[i].trim();
+        if (line.empty() || line.startswith("#")) {
+            continue;
+        }
+        SmallVector<StringRef, 3> fields;
+        line.split(fields, ',');
+        uint64_t offset;
+        if (fields.size() < 2 || fields[1].getAsInteger(10, offset)) {
+            return reportError(DumpPath + ":" + Twine(i + 1) +
+                               ": malformed record");
+        }
+        const SymbolLocation *loc = lookupSymbol(fields[0], symbols, ok);
+        if (!loc) {
+            continue;
+        }
+        Entry E = {0, loc->sectionOffset + offset, WRITTEN};
+        if (fields.size() > 2) {
+            E.access = fields[2] == "ro"        ? READ_ONLY
+                       : fields[2] == "escaped" ? ESCAPED
+                                                : WRITTEN;
+        }
+        resolved.push_back(std::make_pair(loc->sectionIndex, E));
+    }
+    return ok;
+}
+
+/**
+ * @brief Resolve every "name,start,stride,count,field offset" range of
+ * global_ranges.dump into one entry per element. Ranges carry no access, so
+ * their entries count as written.
+ *
+ * @return false on failure, already reported
+ */
+static bool resolveRanges(StringRef dump,
+                          const StringMap<SymbolLocation> &symbols,
+                          std::vector<std::pair<uint64_t, Entry>> &resolved) {
+    SmallVector<StringRef, 0> lines;
+    dump.split(lines, '\n', -1, false);
+    bool ok = true;
+    for (unsigned i = 0; i < lines.size(); ++i) {
+        StringRef line = lines[i].trim();
+        if (line.empty() || line.startswith("#")) {
+            continue;
+        }
+        SmallVector<StringRef, 5> fields;
+        line.split(fields, ',');
+        uint64_t values[4];
+        bool malformed = fields.size() != 5;
+        for (unsigned f = 0; !malformed && f < 4; ++f) {
+            malformed = fields[f + 1].getAsInteger(10, values[f]);
+        }
+        if (malformed) {
+            return reportError(RangesPath + ":" + Twine(i + 1) +
+                               ": malformed range");
+        }
+        const SymbolLocation *loc = lookupSymbol(fields[0], symbols, ok);
+        if (!loc) {
+            continue;
+        }
+        for (uint64_t element = 0; element < values[2]; ++element) {
+            Entry E = {0,
+                       loc->sectionOffset + values[0] + element * values[1] +
+                           values[3],
+                       WRITTEN};
+            resolved.push_back(std::make_pair(loc->sectionIndex, E));
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief Write the table: sections referenced, then entries sorted by
+ * section and offset, see runtime/mvx_relocs.h
+ */
+static void writeTable(
+    raw_ostream &OS, std::vector<std::pair<uint64_t, Entry>> &resolved,
+    const DenseMap<uint64_t, std::pair<uint64_t, std::string>> &sections) {
+    // Number the sections used in order of their ELF index
+    std::vector<uint64_t> used;
+    for (const auto &R : resolved) {
+        used.push_back(R.first);
+    }
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+
+    std::vector<Entry> entries;
+    for (auto &R : resolved) {
+        R.second.section =
+            std::lower_bound(used.begin(), used.end(), R.first) - used.begin();
+        entries.push_back(R.second);
+    }
+    std::sort(entries.begin(), entries.end());
+    // A slot both recorded and in a range keeps its most restrictive access
+    std::vector<Entry> merged;
+    for (const Entry &E : entries) {
+        if (!merged.empty() && !(merged.back() < E)) {
+            merged.back().access = std::max(merged.back().access, E.access);
+        } else {
+            merged.push_back(E);
+        }
+    }
+    entries.swap(merged);
+
+    std::vector<uint64_t> sectionAddress, nameStart, offsets;
+    std::vector<std::string> names;
+    std::vector<uint32_t> sectionOf, access;
+    for (uint64_t index : used) {
+        const auto &section = sections.find(index)->second;
+        sectionAddress.push_back(section.first);
+        names.push_back(section.second);
+    }
+    std::string nameBlob;
+    CSRWriter::appendStrings(names, nameStart, nameBlob);
+    for (const Entry &E : entries) {
+        offsets.push_back(E.offset);
+        sectionOf.push_back(E.section);
+        access.push_back(E.access);
+    }
+
+    CSRWriter writer(OS);
+    writer.writeMagic("MVXRELT1");
+    writer.writeArray(ArrayRef<uint64_t>{used.size(), entries.size(),
+                                         nameBlob.size()});
+    writer.writeArray(sectionAddress);
+    writer.writeArray(nameStart);
+    writer.writeBlob(nameBlob);
+    writer.writeArray(offsets);
+    writer.writeArray(sectionOf);
+    writer.writeArray(access);
+}
+
+/**
+ * @brief Run objcopy with the given arguments
+ *
+ * @return false if it couldn't be run or exited with an error
+ */
+static bool runObjcopy(StringRef objcopyPath, ArrayRef<StringRef> args) {
+    std::vector<StringRef> argv{objcopyPath};
+    argv.insert(argv.end(), args.begin(), args.end());
+    std::string errMsg;
+    if (sys::ExecuteAndWait(objcopyPath, argv, None, {}, 0, 0, &errMsg)) {
+        return reportError(Objcopy + " failed" +
+                           (errMsg.empty() ? "" : ": " + errMsg));
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    cl::ParseCommandLineOptions(argc, argv,
+                                "Embed resolved MVX relocations in a binary\n");
+
+    Expected<OwningBinary<ObjectFile>> binary =
+        ObjectFile::createObjectFile(BinaryPath);
+    if (!binary) {
+        reportError("can't read " + BinaryPath + ": " +
+                    toString(binary.takeError()));
+        return 1;
+    }
+    const ELFObjectFileBase *Obj =
+        dyn_cast<ELFObjectFileBase>(binary->getBinary());
+    if (!Obj) {
+        reportError(BinaryPath + " isn't an ELF file");
+        return 1;
+    }
+    ErrorOr<std::unique_ptr<MemoryBuffer>> dump =
+        MemoryBuffer::getFile(DumpPath);
+    if (!dump) {
+        reportError("can't read " + DumpPath + ": " +
+                    dump.getError().message());
+        return 1;
+    }
+
+    StringMap<SymbolLocation> symbols;
+    DenseMap<uint64_t, std::pair<uint64_t, std::string>> sections;
+    indexSymbols(*Obj, symbols, sections);
+    if (symbols.empty()) {
+        reportError(BinaryPath + " has no symbol table, run mvx-resolve "
+                                 "before stripping it");
+        return 1;
+    }
+    std::vector<std::pair<uint64_t, Entry>> resolved;
+    if (!resolveRecords((*dump)->getBuffer(), symbols, resolved)) {
+        return 1;
+    }
+    if (!RangesPath.empty()) {
+        ErrorOr<std::unique_ptr<MemoryBuffer>> ranges =
+            MemoryBuffer::getFile(RangesPath);
+        if (!ranges) {
+            reportError("can't read " + RangesPath + ": " +
+                        ranges.getError().message());
+            return 1;
+        }
+        if (!resolveRanges((*ranges)->getBuffer(), symbols, resolved)) {
+            return 1;
+        }
+    }
+
+    if (TableOnly) {
+        if (Output.empty()) {
+            reportError("-table-only needs -o");
+            return 1;
+        }
+        std::error_code E;
+        raw_fd_ostream out(Output, E, sys::fs::OF_None);
+        if (E) {
+            reportError("can't write " + Output + ": " + E.message());
+            return 1;
+        }
+        writeTable(out, resolved, sections);
+        return 0;
+    }
+
+    SmallString<128> tablePath;
+    if (std::error_code E =
+            sys::fs::createTemporaryFile("mvx-relocs", "bin", tablePath)) {
+        reportError("can't create temporary file: " + E.message());
+        return 1;
+    }
+    FileRemover removeTable(tablePath);
+    {
+        std::error_code E;
+        raw_fd_ostream out(tablePath, E, sys::fs::OF_None);
+        if (E) {
+            reportError("can't write " + tablePath + ": " + E.message());
+            return 1;
+        }
+        writeTable(out, resolved, sections);
+    }
+    // The section table was read from the input, release it before objcopy
+    // rewrites the file in place
+    *binary = OwningBinary<ObjectFile>();
+
+    ErrorOr<std::string> objcopyPath = sys::findProgramByName(Objcopy);
+    if (!objcopyPath) {
+        reportError("can't find " + Objcopy);
+        return 1;
+    }
+    std::string addSection = (Twine(SECTION_NAME) + "=" + tablePath).str();
+    std::string sectionFlags =
+        (Twine(SECTION_NAME) + "=contents,readonly").str();
+    std::string sectionAlign = (Twine(SECTION_NAME) + "=8").str();
+    StringRef target = Output.empty() ? StringRef(BinaryPath) : Output;
+    // objcopy lays out added sections before applying alignments, so the
+    // section is aligned in a second run for the runtime to use it in place
+    if (!runObjcopy(*objcopyPath,
+                    {"--remove-section", SECTION_NAME, "--add-section",
+                     addSection, "--set-section-flags", sectionFlags,
+                     BinaryPath, target}) ||
+        !runObjcopy(*objcopyPath,
+                    {"--set-section-alignment", sectionAlign, target})) {
+        return 1;
+    }
+    outs() << "mvx-resolve: " << resolved.size() << " records resolved\n";
+    return 0;
+}